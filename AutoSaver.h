@@ -0,0 +1,151 @@
+#ifndef AUTOSAVER_H
+#define AUTOSAVER_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <stdexcept>
+#include <cstdint>
+#include "TextDocument.h"
+
+using namespace std;
+
+// Writes snapshots of a document to disk on a background thread, so saving does not hold up editing.
+// Only the newest snapshot waits while another one is being written; older waiting ones are dropped.
+class AutoSaver {
+public:
+    struct Status {
+        size_t saves = 0;
+        uint64_t lastBytes = 0;
+        double lastMilliseconds = 0; // time the background thread needed for the last save
+        string lastError;
+        bool isSaving = false;
+    };
+
+private:
+    mutable mutex stateMutex;
+    condition_variable wake;
+    unique_ptr<TextDocument> pending;
+    string pendingPath;
+    bool isWriting = false;
+    bool isStopped = false;
+    Status current;
+    thread worker;
+
+    // Writes the lines to a temporary file first, so a crash never leaves a half-written save behind.
+    // Cold lines are decoded one block at a time instead of all up front.
+    static uint64_t writeSnapshot(const TextDocument& snapshot, const string& path) {
+        string target = path + ".tmp";
+        ofstream file(target, ios::out | ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Unable to open file: " + target);
+        }
+
+        const size_t bufferSize = 1 << 20;
+        string buffer;
+        buffer.reserve(bufferSize);
+        uint64_t bytes = 0;
+        ColdLineReader reader;
+        for (const TextNode* current = snapshot.first(); current; current = current->next.get()) {
+            buffer.append(reader.read(current));
+            if (current->next || snapshot.hasLazyLines()) {
+                buffer += '\n';
+            }
+            if (buffer.size() >= bufferSize) {
+                file.write(buffer.data(), buffer.size());
+                bytes += buffer.size();
+                buffer.clear();
+            }
+        }
+        string_view lazyLines = snapshot.lazyLines();
+        file.write(buffer.data(), buffer.size());
+        file.write(lazyLines.data(), lazyLines.size());
+        bytes += buffer.size() + lazyLines.size();
+
+        file.close();
+        if (!file) {
+            throw runtime_error("Unable to write file: " + target);
+        }
+        filesystem::rename(target, path);
+        return bytes;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(stateMutex);
+        while (true) {
+            wake.wait(lock, [this] { return isStopped || pending; });
+            if (!pending) {
+                return; // stopped and nothing left to write
+            }
+            unique_ptr<TextDocument> snapshot = move(pending);
+            string path = pendingPath;
+            isWriting = true;
+            lock.unlock();
+
+            auto start = chrono::steady_clock::now();
+            uint64_t bytes = 0;
+            string error;
+            try {
+                bytes = writeSnapshot(*snapshot, path);
+            } catch (const exception& e) {
+                error = e.what();
+            }
+            snapshot.reset();
+            double milliseconds = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+            lock.lock();
+            isWriting = false;
+            current.lastError = error;
+            if (error.empty()) {
+                current.saves++;
+                current.lastBytes = bytes;
+                current.lastMilliseconds = milliseconds;
+            }
+        }
+    }
+
+public:
+    AutoSaver() : worker(&AutoSaver::run, this) {}
+
+    // Finishes the save in progress and the one waiting for it
+    ~AutoSaver() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            isStopped = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    AutoSaver(const AutoSaver&) = delete;
+    AutoSaver& operator=(const AutoSaver&) = delete;
+
+    void submit(TextDocument snapshot, const string& path) {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            pending = make_unique<TextDocument>(move(snapshot));
+            pendingPath = path;
+        }
+        wake.notify_one();
+    }
+
+    bool isBusy() const {
+        lock_guard<mutex> lock(stateMutex);
+        return isWriting || pending;
+    }
+
+    Status status() const {
+        lock_guard<mutex> lock(stateMutex);
+        Status result = current;
+        result.isSaving = isWriting || pending;
+        return result;
+    }
+};
+
+#endif // AUTOSAVER_H
@@ -0,0 +1,66 @@
+#ifndef BUFFEREDOUTPUT_H
+#define BUFFEREDOUTPUT_H
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <charconv>
+
+using namespace std;
+
+// Collects output in one buffer and hands it to the stream in large blocks
+class BufferedOutput {
+private:
+    ostream& out;
+    string buffer;
+    const size_t capacity;
+
+public:
+    explicit BufferedOutput(ostream& out = cout, size_t capacity = 1 << 16) : out(out), capacity(capacity) {
+        buffer.reserve(capacity);
+    }
+
+    ~BufferedOutput() {
+        flush();
+    }
+
+    BufferedOutput(const BufferedOutput&) = delete;
+    BufferedOutput& operator=(const BufferedOutput&) = delete;
+
+    BufferedOutput& operator<<(string_view text) {
+        if (buffer.size() + text.size() > capacity) {
+            flush();
+            // Large pieces go straight to the stream instead of through the buffer
+            if (text.size() > capacity) {
+                out.write(text.data(), text.size());
+                return *this;
+            }
+        }
+        buffer.append(text.data(), text.size());
+        return *this;
+    }
+
+    BufferedOutput& operator<<(char symbol) {
+        if (buffer.size() + 1 > capacity) {
+            flush();
+        }
+        buffer.push_back(symbol);
+        return *this;
+    }
+
+    BufferedOutput& operator<<(size_t number) {
+        char digits[24];
+        auto result = to_chars(digits, digits + sizeof(digits), number);
+        return *this << string_view(digits, result.ptr - digits);
+    }
+
+    void flush() {
+        if (!buffer.empty()) {
+            out.write(buffer.data(), buffer.size());
+            buffer.clear();
+        }
+        out.flush();
+    }
+};
+
+#endif // BUFFEREDOUTPUT_H
@@ -0,0 +1,250 @@
+#ifndef CASEFOLDING_H
+#define CASEFOLDING_H
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+// Case folding helpers for case-insensitive search.
+// Only simple folds that keep the UTF-8 length of a character are applied (ASCII, Latin-1,
+// Latin Extended-A, Greek and Cyrillic), so a match is always as long as the pattern in bytes.
+class CaseFolding {
+public:
+    static char foldAscii(char symbol) {
+        return (symbol >= 'A' && symbol <= 'Z') ? symbol + ('a' - 'A') : symbol;
+    }
+
+    static char32_t foldCodePoint(char32_t code) {
+        if (code < 0x80) {
+            return (code >= 'A' && code <= 'Z') ? code + 0x20 : code;
+        }
+        if (code >= 0xC0 && code <= 0xDE && code != 0xD7) {
+            return code + 0x20;
+        }
+        if (code >= 0x100 && code <= 0x17F) {
+            if ((code <= 0x12F) || (code >= 0x132 && code <= 0x137) || (code >= 0x14A && code <= 0x177)) {
+                return code | 1;
+            }
+            if ((code >= 0x139 && code <= 0x148) || (code >= 0x179 && code <= 0x17E)) {
+                return (code & 1) ? code + 1 : code;
+            }
+            if (code == 0x178) {
+                return 0xFF;
+            }
+            return code;
+        }
+        if (code >= 0x391 && code <= 0x3A9 && code != 0x3A2) {
+            return code + 0x20;
+        }
+        if (code >= 0x410 && code <= 0x42F) {
+            return code + 0x20;
+        }
+        if (code >= 0x400 && code <= 0x40F) {
+            return code + 0x50;
+        }
+        return code;
+    }
+
+    // Code that an invalid or truncated byte decodes to; a valid U+FFFD is three bytes long, so
+    // isInvalidByte tells them apart
+    static constexpr char32_t replacementCharacter = 0xFFFD;
+
+    static bool isInvalidByte(char32_t code, size_t length) {
+        return code == replacementCharacter && length == 1;
+    }
+
+    // Decodes one UTF-8 character; an invalid byte decodes to replacementCharacter with length 1
+    static size_t decodeUtf8(const char* text, size_t available, char32_t& code) {
+        unsigned char lead = text[0];
+        size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+        if (length == 0 || length > available) {
+            code = replacementCharacter;
+            return 1;
+        }
+        if (length == 1) {
+            code = lead;
+            return 1;
+        }
+        code = lead & (0x7F >> length);
+        for (size_t i = 1; i < length; i++) {
+            unsigned char continuation = text[i];
+            if ((continuation & 0xC0) != 0x80) {
+                code = replacementCharacter;
+                return 1;
+            }
+            code = (code << 6) | (continuation & 0x3F);
+        }
+        return length;
+    }
+
+    static void appendUtf8(string& out, char32_t code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    static string foldUtf8(string_view text) {
+        string folded;
+        folded.reserve(text.size());
+        for (size_t i = 0; i < text.size();) {
+            char32_t code;
+            size_t length = decodeUtf8(text.data() + i, text.size() - i, code);
+            if (isInvalidByte(code, length)) {
+                folded += text[i]; // keep invalid bytes as they are
+            } else {
+                appendUtf8(folded, foldCodePoint(code));
+            }
+            i += length;
+        }
+        return folded;
+    }
+
+    static bool isAscii(string_view text) {
+        for (char symbol : text) {
+            if (static_cast<unsigned char>(symbol) >= 0x80) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Compares text against an already folded ASCII pattern, folding the text on the fly
+    static bool equalsFoldedAscii(const char* text, const char* folded, size_t length) {
+        size_t i = 0;
+#if defined(__SSE2__)
+        for (; i + 16 <= length; i += 16) {
+            __m128i block = foldBlock(_mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i)));
+            __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(folded + i));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi8(block, expected)) != 0xFFFF) {
+                return false;
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 16 <= length; i += 16) {
+            uint8x16_t block = foldBlock(vld1q_u8(reinterpret_cast<const uint8_t*>(text + i)));
+            uint8x16_t expected = vld1q_u8(reinterpret_cast<const uint8_t*>(folded + i));
+            if (vminvq_u8(vceqq_u8(block, expected)) != 0xFF) {
+                return false;
+            }
+        }
+#endif
+        for (; i < length; i++) {
+            if (foldAscii(text[i]) != folded[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Finds a folded ASCII pattern in text, 16 bytes at a time where SIMD is available
+    static size_t findFoldedAscii(string_view text, size_t from, const string& folded) {
+        if (folded.empty() || from >= text.size() || text.size() - from < folded.size()) {
+            return string_view::npos;
+        }
+        const char* begin = text.data();
+        const size_t last = text.size() - folded.size();
+        const char first = folded[0];
+        const char firstUpper = (first >= 'a' && first <= 'z') ? first - ('a' - 'A') : first;
+        size_t i = from;
+
+#if defined(__SSE2__)
+        const __m128i lower = _mm_set1_epi8(first);
+        const __m128i upper = _mm_set1_epi8(firstUpper);
+        for (; i + 16 <= last + 1; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin + i));
+            unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, lower), _mm_cmpeq_epi8(block, upper)));
+            while (mask) {
+                size_t candidate = i + __builtin_ctz(mask);
+                if (equalsFoldedAscii(begin + candidate + 1, folded.data() + 1, folded.size() - 1)) {
+                    return candidate;
+                }
+                mask &= mask - 1;
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t lower = vdupq_n_u8(first);
+        const uint8x16_t upper = vdupq_n_u8(firstUpper);
+        for (; i + 16 <= last + 1; i += 16) {
+            uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(begin + i));
+            if (vmaxvq_u8(vorrq_u8(vceqq_u8(block, lower), vceqq_u8(block, upper))) == 0) {
+                continue;
+            }
+            for (size_t candidate = i; candidate < i + 16; candidate++) {
+                if (foldAscii(begin[candidate]) == first &&
+                    equalsFoldedAscii(begin + candidate + 1, folded.data() + 1, folded.size() - 1)) {
+                    return candidate;
+                }
+            }
+        }
+#endif
+        for (; i <= last; i++) {
+            if (foldAscii(begin[i]) == first && equalsFoldedAscii(begin + i + 1, folded.data() + 1, folded.size() - 1)) {
+                return i;
+            }
+        }
+        return string_view::npos;
+    }
+
+    // Compares text against a folded UTF-8 pattern character by character
+    static bool equalsFoldedUtf8(string_view text, size_t at, string_view folded) {
+        size_t i = at;
+        size_t j = 0;
+        while (j < folded.size()) {
+            if (i >= text.size()) {
+                return false;
+            }
+            char32_t textCode, patternCode;
+            size_t textLength = decodeUtf8(text.data() + i, text.size() - i, textCode);
+            size_t patternLength = decodeUtf8(folded.data() + j, folded.size() - j, patternCode);
+            bool isTextInvalid = isInvalidByte(textCode, textLength);
+            bool isPatternInvalid = isInvalidByte(patternCode, patternLength);
+            if (isTextInvalid || isPatternInvalid) {
+                // An invalid byte only matches the same invalid byte
+                if (!isTextInvalid || !isPatternInvalid || text[i] != folded[j]) {
+                    return false;
+                }
+            } else if (foldCodePoint(textCode) != patternCode) {
+                return false;
+            }
+            i += textLength;
+            j += patternLength;
+        }
+        return true;
+    }
+
+private:
+#if defined(__SSE2__)
+    static __m128i foldBlock(__m128i block) {
+        // Moves 'A'..'Z' to the bottom of the signed range so one compare selects them
+        __m128i shifted = _mm_add_epi8(block, _mm_set1_epi8(static_cast<char>(128 - 'A')));
+        __m128i isUpper = _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + 26)));
+        return _mm_or_si128(block, _mm_and_si128(isUpper, _mm_set1_epi8(0x20)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static uint8x16_t foldBlock(uint8x16_t block) {
+        uint8x16_t isUpper = vcltq_u8(vsubq_u8(block, vdupq_n_u8('A')), vdupq_n_u8(26));
+        return vorrq_u8(block, vandq_u8(isUpper, vdupq_n_u8(0x20)));
+    }
+#endif
+};
+
+#endif // CASEFOLDING_H
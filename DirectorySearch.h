@@ -0,0 +1,150 @@
+#ifndef DIRECTORYSEARCH_H
+#define DIRECTORYSEARCH_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sstream>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include "FileReader.h"
+#include "SearchEngine.h"
+
+using namespace std;
+
+// Searches every regular file under a directory on a pool of worker threads.
+// Files are memory-mapped and searched in parallel, results are printed in path order.
+class DirectorySearch {
+private:
+    struct FileResult {
+        string output;
+        string error;
+        size_t matches = 0;
+        bool isDone = false;
+    };
+
+    const TextSearcher searcher;
+    const SearchMode mode;
+    const size_t limit;
+
+    vector<string> files;
+    vector<FileResult> results;
+    atomic<size_t> nextFile{0};
+    atomic<bool> isStopped{false};
+    mutex resultsMutex;
+    condition_variable resultReady;
+
+    void searchFile(size_t index) {
+        FileResult result;
+        try {
+            MappedFile file(files[index]);
+            string_view text = file.view();
+
+            ostringstream fileOut;
+            string prefix = files[index] + ": ";
+            {
+                BufferedOutput buffered(fileOut);
+                MatchReporter reporter(buffered, mode, limit);
+                reporter.setPrefix(prefix);
+
+                searchLines(text, 0, searcher, reporter);
+                result.matches = reporter.matchCount();
+            }
+            result.output = fileOut.str();
+        } catch (const runtime_error& e) {
+            result.error = e.what();
+        }
+
+        lock_guard<mutex> lock(resultsMutex);
+        result.isDone = true;
+        results[index] = move(result);
+        resultReady.notify_all();
+    }
+
+    void worker() {
+        size_t index;
+        while (!isStopped && (index = nextFile++) < files.size()) {
+            searchFile(index);
+        }
+    }
+
+    // Writes at most maxLines lines of text
+    static void writeLines(BufferedOutput& out, string_view text, size_t maxLines) {
+        size_t end = 0;
+        for (size_t line = 0; line < maxLines && end < text.size(); line++) {
+            size_t newline = text.find('\n', end);
+            end = (newline == string_view::npos) ? text.size() : newline + 1;
+        }
+        out << text.substr(0, end);
+    }
+
+public:
+    DirectorySearch(const string& pattern, bool ignoreCase, SearchMode mode, size_t limit)
+        : searcher(pattern, ignoreCase), mode(mode), limit(limit) {}
+
+    // Returns the total number of matches
+    size_t run(const string& directory, BufferedOutput& out) {
+        for (const auto& entry : filesystem::recursive_directory_iterator(directory, filesystem::directory_options::skip_permission_denied)) {
+            if (entry.is_regular_file()) {
+                files.push_back(entry.path().string());
+            }
+        }
+        sort(files.begin(), files.end());
+        results.assign(files.size(), FileResult());
+
+        size_t threadCount = max(1u, thread::hardware_concurrency());
+        threadCount = min(threadCount, max<size_t>(files.size(), 1));
+        vector<thread> workers;
+        for (size_t i = 0; i < threadCount; i++) {
+            workers.emplace_back(&DirectorySearch::worker, this);
+        }
+
+        // Stream results in path order while later files are still being searched
+        size_t totalMatches = 0;
+        size_t matchedFiles = 0;
+        for (size_t index = 0; index < files.size() && !isStopped; index++) {
+            FileResult result;
+            {
+                unique_lock<mutex> lock(resultsMutex);
+                resultReady.wait(lock, [&] { return results[index].isDone; });
+                result = move(results[index]);
+            }
+            if (!result.error.empty()) {
+                out.flush();
+                cerr << "Error: " << result.error << endl;
+                continue;
+            }
+            if (result.matches == 0) {
+                continue;
+            }
+            matchedFiles++;
+            if (mode == SearchMode::FirstN && totalMatches + result.matches >= limit) {
+                writeLines(out, result.output, limit - totalMatches);
+                totalMatches = limit;
+                isStopped = true;
+            } else {
+                out << result.output;
+                totalMatches += result.matches;
+            }
+        }
+
+        isStopped = true;
+        for (thread& worker : workers) {
+            worker.join();
+        }
+
+        if (totalMatches == 0) {
+            out << "Text not found!\n";
+        } else if (mode == SearchMode::CountOnly) {
+            out << "Found " << totalMatches << " occurrence(s) in " << matchedFiles << " file(s)\n";
+        }
+        out.flush();
+        return totalMatches;
+    }
+};
+
+#endif // DIRECTORYSEARCH_H
@@ -0,0 +1,446 @@
+#ifndef EDITJOURNAL_H
+#define EDITJOURNAL_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <cerrno>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <share.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#endif
+
+using namespace std;
+
+// Editor operations as they are stored in the journal
+enum class JournalOp : uint8_t {
+    Base,              // text: file the edits start from, empty for a new document; count 1 if opened lazily
+    AppendText,        // text
+    NewLine,
+    Insert,            // line, position, text
+    Delete,            // line, position, count
+    Cut,               // line, position, count
+    Paste,             // line, position, text: the clipboard at that time
+    Replace,           // line, position, text
+    ReplaceAll,        // text: pattern, extra: replacement, count: flags
+    MoveCursor,        // line, position
+    TypeAtCursor,      // text
+    EraseBeforeCursor, // count
+    EraseAfterCursor,  // count
+    ApplyEdits,        // text: the packed batch, count: number of edits
+    SetLines           // text: lines packed by packLines, count: lines afterwards or 0 to keep them; undo and redo
+};
+
+struct JournalRecord {
+    JournalOp op = JournalOp::Base;
+    uint64_t line = 0;
+    uint64_t position = 0;
+    uint64_t count = 0;
+    string text;
+    string extra;
+};
+
+// Append-only log of the edits made since the document was last loaded or saved.
+// Records are written and flushed to disk by a background thread: edits that arrive within
+// one group window share a single fsync, so editing never waits for the disk.
+// Every record carries its size and a checksum; recovery stops at the first torn record.
+// After a failed write the journal takes no more records until it is restarted: recovery then
+// gives back the document as of the last record that reached the disk, never a mix.
+class EditJournal {
+public:
+    struct Stats {
+        size_t records = 0;
+        size_t syncs = 0;
+        uint64_t bytes = 0;
+        size_t lostRecords = 0; // records appended after a failure, they are not on disk
+        string error;           // why the journal failed, empty while it works
+    };
+
+private:
+    static constexpr char magic[4] = {'T', 'X', 'J', '1'};
+
+    const string path;
+    const chrono::milliseconds groupWindow;
+    FILE* file = nullptr;
+    mutable mutex stateMutex;
+    condition_variable wake;
+    condition_variable drained;
+    string buffer; // records waiting for the next group commit
+    bool isWriting = false;
+    bool isStopped = false;
+    size_t bufferedRecords = 0;
+    Stats stats;
+    thread flusher;
+
+    static uint32_t checksum(string_view data) {
+        uint32_t hash = 2166136261u; // FNV-1a
+        for (unsigned char byte : data) {
+            hash = (hash ^ byte) * 16777619u;
+        }
+        return hash;
+    }
+
+    template <typename T>
+    static void put(string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static bool get(string_view& in, T& value) {
+        if (in.size() < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+
+    static bool getText(string_view& in, string& text) {
+        uint32_t size;
+        if (!get(in, size) || in.size() < size) {
+            return false;
+        }
+        text.assign(in.data(), size);
+        in.remove_prefix(size);
+        return true;
+    }
+
+    static void encode(string& out, const JournalRecord& record) {
+        string payload;
+        put(payload, static_cast<uint8_t>(record.op));
+        put(payload, record.line);
+        put(payload, record.position);
+        put(payload, record.count);
+        put(payload, static_cast<uint32_t>(record.text.size()));
+        payload += record.text;
+        put(payload, static_cast<uint32_t>(record.extra.size()));
+        payload += record.extra;
+
+        put(out, static_cast<uint32_t>(payload.size()));
+        put(out, checksum(payload));
+        out += payload;
+    }
+
+    // Opens the journal for writing and locks it, so two editors never write to the same journal.
+    // The lock goes with the file: it is held until the journal is destroyed.
+    static FILE* openLocked(const string& journalPath) {
+#ifdef _WIN32
+        int descriptor;
+        if (_sopen_s(&descriptor, journalPath.c_str(), _O_RDWR | _O_CREAT | _O_BINARY, _SH_DENYRW,
+                     _S_IREAD | _S_IWRITE) != 0) {
+            throw runtime_error("Unable to open journal, another editor may be using it: " + journalPath);
+        }
+        FILE* opened = _fdopen(descriptor, "r+b");
+        if (!opened) {
+            _close(descriptor);
+        }
+#else
+        int descriptor = open(journalPath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (descriptor < 0) {
+            throw runtime_error("Unable to open journal: " + journalPath);
+        }
+        if (flock(descriptor, LOCK_EX | LOCK_NB) != 0) {
+            close(descriptor);
+            throw runtime_error("Journal is used by another editor: " + journalPath);
+        }
+        FILE* opened = fdopen(descriptor, "r+b");
+        if (!opened) {
+            close(descriptor);
+        }
+#endif
+        if (!opened) {
+            throw runtime_error("Unable to open journal: " + journalPath);
+        }
+        return opened;
+    }
+
+    // Cuts the file to size and goes on writing at its end
+    bool truncateTo(uint64_t size) {
+        if (fflush(file) != 0) {
+            return false;
+        }
+#ifdef _WIN32
+        bool isTruncated = _chsize_s(_fileno(file), size) == 0;
+#else
+        bool isTruncated = ftruncate(fileno(file), size) == 0;
+#endif
+        return isTruncated && fseek(file, static_cast<long>(size), SEEK_SET) == 0;
+    }
+
+    void writeAndSync(const string& data) {
+        if (fwrite(data.data(), 1, data.size(), file) != data.size() || fflush(file) != 0) {
+            throw runtime_error("Unable to write journal: " + path);
+        }
+#ifdef _WIN32
+        bool isSynced = _commit(_fileno(file)) == 0;
+#else
+        bool isSynced = fdatasync(fileno(file)) == 0;
+#endif
+        if (!isSynced) {
+            throw runtime_error("Unable to sync journal: " + path);
+        }
+    }
+
+    // Called with stateMutex held
+    void failWith(const string& message, size_t lostRecords) {
+        if (stats.error.empty()) {
+            stats.error = message;
+        }
+        stats.records -= lostRecords;
+        stats.lostRecords += lostRecords;
+    }
+
+    void run() {
+        unique_lock<mutex> lock(stateMutex);
+        while (true) {
+            wake.wait(lock, [this] { return isStopped || !buffer.empty(); });
+            if (buffer.empty()) {
+                return;
+            }
+            if (!isStopped) {
+                // Give the edits that follow right after a chance to share this commit
+                wake.wait_for(lock, groupWindow, [this] { return isStopped; });
+            }
+            string batch;
+            batch.swap(buffer);
+            size_t batchRecords = bufferedRecords;
+            bufferedRecords = 0;
+            if (!stats.error.empty()) {
+                // Written after the records that were lost, these would be replayed without them
+                failWith(stats.error, batchRecords);
+                drained.notify_all();
+                continue;
+            }
+            isWriting = true;
+            lock.unlock();
+            string error;
+            try {
+                writeAndSync(batch);
+            } catch (const runtime_error& e) {
+                error = e.what();
+            }
+            lock.lock();
+            isWriting = false;
+            if (error.empty()) {
+                stats.syncs++;
+                stats.bytes += batch.size();
+            } else {
+                failWith(error, batchRecords);
+            }
+            drained.notify_all();
+        }
+    }
+
+public:
+    // Starts a new journal, replacing an old one at the same path
+    EditJournal(const string& journalPath, chrono::milliseconds window = chrono::milliseconds(20))
+        : path(journalPath), groupWindow(window) {
+        file = openLocked(path);
+        try {
+            if (!truncateTo(0)) {
+                throw runtime_error("Unable to open journal: " + path);
+            }
+            writeAndSync(string(magic, sizeof(magic)));
+        } catch (const runtime_error&) {
+            fclose(file);
+            throw;
+        }
+        flusher = thread(&EditJournal::run, this);
+    }
+
+    // Continues a journal that was just recovered, after its last complete record
+    EditJournal(const string& journalPath, uint64_t validBytes, chrono::milliseconds window = chrono::milliseconds(20))
+        : path(journalPath), groupWindow(window) {
+        file = openLocked(path);
+        if (!truncateTo(validBytes)) {
+            fclose(file);
+            throw runtime_error("Unable to open journal: " + path);
+        }
+        flusher = thread(&EditJournal::run, this);
+    }
+
+    // Writes the records still waiting and closes the file
+    ~EditJournal() {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            isStopped = true;
+        }
+        wake.notify_one();
+        flusher.join();
+        fclose(file);
+    }
+
+    EditJournal(const EditJournal&) = delete;
+    EditJournal& operator=(const EditJournal&) = delete;
+
+    void append(const JournalRecord& record) {
+        {
+            lock_guard<mutex> lock(stateMutex);
+            if (!stats.error.empty()) {
+                stats.lostRecords++;
+                return;
+            }
+            encode(buffer, record);
+            bufferedRecords++;
+            stats.records++;
+        }
+        wake.notify_one();
+    }
+
+    // Stops taking records, e.g. when the document could not be written as a new base
+    void fail(const string& message) {
+        lock_guard<mutex> lock(stateMutex);
+        failWith(message, 0);
+    }
+
+    // Waits until everything appended so far is on disk
+    void flush() {
+        wake.notify_one();
+        unique_lock<mutex> lock(stateMutex);
+        drained.wait(lock, [this] { return buffer.empty() && !isWriting; });
+    }
+
+    // Drops all records and starts over from a new base; a journal that failed works again after it
+    void restart(const JournalRecord& base) {
+        flush();
+        lock_guard<mutex> lock(stateMutex);
+        // The same file is cut back, reopening it would give up the lock
+        if (!truncateTo(0)) {
+            failWith("Unable to write journal: " + path, 0);
+            throw runtime_error("Unable to write journal: " + path);
+        }
+        string data(magic, sizeof(magic));
+        encode(data, base);
+        try {
+            writeAndSync(data);
+        } catch (const runtime_error& e) {
+            failWith(e.what(), 0);
+            throw;
+        }
+        stats.error.clear();
+        stats.records++;
+        stats.syncs++;
+        stats.bytes += data.size();
+    }
+
+    // Line numbers with their new text, e.g. the lines an undo step changed
+    static string packLines(const vector<pair<uint64_t, string_view>>& lines) {
+        string out;
+        for (const auto& [line, text] : lines) {
+            put(out, line);
+            put(out, static_cast<uint32_t>(text.size()));
+            out.append(text.data(), text.size());
+        }
+        return out;
+    }
+
+    static vector<pair<uint64_t, string>> unpackLines(string_view in) {
+        vector<pair<uint64_t, string>> lines;
+        while (!in.empty()) {
+            uint64_t line;
+            string text;
+            if (!get(in, line) || !getText(in, text)) {
+                throw runtime_error("Damaged journal record");
+            }
+            lines.emplace_back(line, move(text));
+        }
+        return lines;
+    }
+
+    Stats statistics() const {
+        lock_guard<mutex> lock(stateMutex);
+        return stats;
+    }
+
+    // True while another editor holds the journal at journalPath
+    static bool isInUse(const string& journalPath) {
+#ifdef _WIN32
+        int descriptor;
+        if (_sopen_s(&descriptor, journalPath.c_str(), _O_RDONLY | _O_BINARY, _SH_DENYRW, 0) != 0) {
+            return errno == EACCES;
+        }
+        _close(descriptor);
+        return false;
+#else
+        int descriptor = open(journalPath.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            return false;
+        }
+        bool isLocked = flock(descriptor, LOCK_EX | LOCK_NB) != 0;
+        close(descriptor);
+        return isLocked;
+#endif
+    }
+
+    // Reads the complete records of a journal; validBytes tells where the last one ends
+    static vector<JournalRecord> read(const string& journalPath, uint64_t& validBytes) {
+        vector<JournalRecord> records;
+        validBytes = 0;
+        FILE* input = fopen(journalPath.c_str(), "rb");
+        if (!input) {
+            return records;
+        }
+        string data;
+        char chunk[1 << 16];
+        size_t bytesRead;
+        while ((bytesRead = fread(chunk, 1, sizeof(chunk), input)) > 0) {
+            data.append(chunk, bytesRead);
+        }
+        fclose(input);
+        if (data.size() < sizeof(magic) || memcmp(data.data(), magic, sizeof(magic)) != 0) {
+            return records;
+        }
+
+        string_view in(data);
+        in.remove_prefix(sizeof(magic));
+        while (true) {
+            string_view rest = in;
+            uint32_t size, sum;
+            if (!get(rest, size) || !get(rest, sum) || rest.size() < size) {
+                break;
+            }
+            string_view payload = rest.substr(0, size);
+            if (checksum(payload) != sum) {
+                break;
+            }
+            JournalRecord record;
+            uint8_t op;
+            if (!get(payload, op) || !get(payload, record.line) || !get(payload, record.position) ||
+                !get(payload, record.count) || !getText(payload, record.text) || !getText(payload, record.extra)) {
+                break;
+            }
+            record.op = static_cast<JournalOp>(op);
+            records.push_back(move(record));
+            in = rest.substr(size);
+        }
+        validBytes = data.size() - in.size();
+        return records;
+    }
+
+    // Flushes a file written elsewhere, e.g. the base a journal starts from
+    static void syncFile(const string& filePath) {
+#ifndef _WIN32
+        int descriptor = open(filePath.c_str(), O_RDONLY);
+        if (descriptor >= 0) {
+            fsync(descriptor);
+            close(descriptor);
+        }
+#endif
+    }
+};
+
+#endif // EDITJOURNAL_H
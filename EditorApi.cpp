@@ -0,0 +1,392 @@
+#include "EditorApi.h"
+
+#include <string>
+#include <sstream>
+#include <climits>
+#include <cstring>
+#include <regex>
+#include <stdexcept>
+#include "TextList.h"
+
+using namespace std;
+
+struct Editor {
+    TextList list;
+    string lastError;
+};
+
+namespace {
+
+// Runs an engine call, turning its exceptions into status codes
+template <typename Call>
+EditorStatus guard(Editor* editor, Call call) {
+    if (!editor) {
+        return EDITOR_INVALID_ARGUMENT;
+    }
+    editor->lastError.clear();
+    try {
+        return call();
+    } catch (const regex_error& e) {
+        editor->lastError = e.what();
+        return EDITOR_ERROR;
+    } catch (const filesystem::filesystem_error& e) {
+        editor->lastError = e.what();
+        return EDITOR_IO_ERROR;
+    } catch (const runtime_error& e) {
+        editor->lastError = e.what();
+        return EDITOR_IO_ERROR;
+    } catch (const exception& e) {
+        editor->lastError = e.what();
+        return EDITOR_ERROR;
+    }
+}
+
+// The engine counts lines and positions in int
+bool fitsInt(size_t value) {
+    return value <= static_cast<size_t>(INT_MAX);
+}
+
+// Lines are split when the text is loaded; text given later has to stay within one line
+bool isLineText(const char* text) {
+    return text && !strchr(text, '\n');
+}
+
+EditorStatus status(bool isDone) {
+    return isDone ? EDITOR_OK : EDITOR_OUT_OF_RANGE;
+}
+
+EditorStatus copyOut(string_view text, char* buffer, size_t capacity, size_t* length) {
+    if (!length) {
+        return EDITOR_INVALID_ARGUMENT;
+    }
+    *length = text.size();
+    if (!buffer || capacity <= text.size()) {
+        return EDITOR_BUFFER_TOO_SMALL;
+    }
+    memcpy(buffer, text.data(), text.size());
+    buffer[text.size()] = '\0';
+    return EDITOR_OK;
+}
+
+} // namespace
+
+extern "C" {
+
+Editor* editorCreate(void) {
+    try {
+        return new Editor();
+    } catch (const exception&) {
+        return nullptr;
+    }
+}
+
+void editorDestroy(Editor* editor) {
+    delete editor;
+}
+
+const char* editorLastError(const Editor* editor) {
+    return editor ? editor->lastError.c_str() : "";
+}
+
+EditorStatus editorLoad(Editor* editor, const char* path, int lazily) {
+    return guard(editor, [&] {
+        if (!path) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        editor->list.loadDocument(path, lazily != 0);
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorSave(Editor* editor, const char* path) {
+    return guard(editor, [&] {
+        if (!path) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        editor->list.saveToFile(path);
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorAppend(Editor* editor, const char* text) {
+    return guard(editor, [&] {
+        if (!isLineText(text)) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        editor->list.appendToEnd(text);
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorNewLine(Editor* editor) {
+    return guard(editor, [&] {
+        editor->list.startNewLine();
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorInsert(Editor* editor, size_t line, size_t position, const char* text) {
+    return guard(editor, [&] {
+        if (!isLineText(text)) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        return status(editor->list.insertText(static_cast<int>(line), static_cast<int>(position), text));
+    });
+}
+
+EditorStatus editorDelete(Editor* editor, size_t line, size_t position, size_t count) {
+    return guard(editor, [&] {
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        int symbols = static_cast<int>(min<size_t>(count, INT_MAX));
+        return status(editor->list.deleteText(static_cast<int>(line), static_cast<int>(position), symbols));
+    });
+}
+
+EditorStatus editorReplace(Editor* editor, size_t line, size_t position, const char* text) {
+    return guard(editor, [&] {
+        if (!isLineText(text)) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        return status(editor->list.replaceText(static_cast<int>(line), static_cast<int>(position), text));
+    });
+}
+
+EditorStatus editorCut(Editor* editor, size_t line, size_t position, size_t count) {
+    return guard(editor, [&] {
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        int symbols = static_cast<int>(min<size_t>(count, INT_MAX));
+        return status(editor->list.cutText(static_cast<int>(line), static_cast<int>(position), symbols));
+    });
+}
+
+EditorStatus editorCopy(Editor* editor, size_t line, size_t position, size_t count) {
+    return guard(editor, [&] {
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        int symbols = static_cast<int>(min<size_t>(count, INT_MAX));
+        return status(editor->list.copyText(static_cast<int>(line), static_cast<int>(position), symbols));
+    });
+}
+
+EditorStatus editorPaste(Editor* editor, size_t line, size_t position) {
+    return guard(editor, [&] {
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        return status(editor->list.pasteText(static_cast<int>(line), static_cast<int>(position)));
+    });
+}
+
+EditorStatus editorReplaceAll(Editor* editor, const char* pattern, const char* replacement, int flags, size_t* replaced) {
+    return guard(editor, [&] {
+        if (!pattern || !*pattern || !isLineText(replacement)) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        size_t count = editor->list.replaceAll(pattern, replacement, flags & EDITOR_REGEX, flags & EDITOR_IGNORE_CASE);
+        if (replaced) {
+            *replaced = count;
+        }
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorSaveChanges(Editor* editor, const char* path, size_t* bytesWritten, int* isFullRewrite) {
+    return guard(editor, [&] {
+        if (!path) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        SaveStats stats = editor->list.saveChanges(path);
+        if (bytesWritten) {
+            *bytesWritten = stats.bytesWritten;
+        }
+        if (isFullRewrite) {
+            *isFullRewrite = stats.isFullRewrite;
+        }
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorStartJournal(Editor* editor, const char* path, int recover, size_t* replayed) {
+    return guard(editor, [&] {
+        if (!path) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        size_t count = editor->list.startJournal(path, recover != 0);
+        if (replayed) {
+            *replayed = count;
+        }
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorCloseSession(Editor* editor) {
+    return guard(editor, [&] {
+        editor->list.closeSession();
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorApplyEdits(Editor* editor, const EditorEdit* edits, size_t count) {
+    return guard(editor, [&] {
+        if (!edits && count > 0) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        vector<TextEdit> batch(count);
+        for (size_t i = 0; i < count; i++) {
+            const EditorEdit& edit = edits[i];
+            switch (edit.kind) {
+                case EDITOR_EDIT_INSERT: batch[i].kind = TextEdit::Kind::Insert; break;
+                case EDITOR_EDIT_DELETE: batch[i].kind = TextEdit::Kind::Delete; break;
+                case EDITOR_EDIT_REPLACE: batch[i].kind = TextEdit::Kind::Replace; break;
+                default: return EDITOR_INVALID_ARGUMENT;
+            }
+            if (edit.kind != EDITOR_EDIT_DELETE && !isLineText(edit.text)) {
+                return EDITOR_INVALID_ARGUMENT;
+            }
+            batch[i].line = edit.line;
+            batch[i].position = edit.position;
+            batch[i].count = edit.count;
+            if (edit.text) {
+                batch[i].text = edit.text;
+            }
+        }
+        return status(editor->list.applyEdits(batch));
+    });
+}
+
+EditorStatus editorAddCursor(Editor* editor, size_t line, size_t position) {
+    return guard(editor, [&] {
+        if (!fitsInt(line) || !fitsInt(position)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        return status(editor->list.addCursor(static_cast<int>(line), static_cast<int>(position)));
+    });
+}
+
+EditorStatus editorCursorCount(const Editor* editor, size_t* count) {
+    if (!editor || !count) {
+        return EDITOR_INVALID_ARGUMENT;
+    }
+    *count = editor->list.multiCursors().size();
+    return EDITOR_OK;
+}
+
+EditorStatus editorGetCursor(const Editor* editor, size_t index, size_t* line, size_t* position) {
+    if (!editor || !line || !position) {
+        return EDITOR_INVALID_ARGUMENT;
+    }
+    const vector<Cursor>& cursors = editor->list.multiCursors();
+    if (index >= cursors.size()) {
+        return EDITOR_OUT_OF_RANGE;
+    }
+    *line = cursors[index].lineIndex;
+    *position = cursors[index].charIndex;
+    return EDITOR_OK;
+}
+
+EditorStatus editorTypeAtCursors(Editor* editor, const char* text) {
+    return guard(editor, [&] {
+        if (!isLineText(text)) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        return status(editor->list.typeAtCursors(text));
+    });
+}
+
+EditorStatus editorEraseBeforeCursors(Editor* editor, size_t count) {
+    return guard(editor, [&] {
+        return status(editor->list.eraseBeforeCursors(count));
+    });
+}
+
+EditorStatus editorEraseAfterCursors(Editor* editor, size_t count) {
+    return guard(editor, [&] {
+        return status(editor->list.eraseAfterCursors(count));
+    });
+}
+
+EditorStatus editorClearCursors(Editor* editor) {
+    return guard(editor, [&] {
+        editor->list.clearCursors();
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorUndo(Editor* editor) {
+    return guard(editor, [&] {
+        if (editor->list.undoLastChange()) {
+            return EDITOR_OK;
+        }
+        if (!editor->list.lastHistoryError().empty()) {
+            editor->lastError = editor->list.lastHistoryError();
+            return EDITOR_IO_ERROR;
+        }
+        return EDITOR_NO_MORE_STEPS;
+    });
+}
+
+EditorStatus editorRedo(Editor* editor) {
+    return guard(editor, [&] {
+        if (editor->list.redoLastChange()) {
+            return EDITOR_OK;
+        }
+        if (!editor->list.lastHistoryError().empty()) {
+            editor->lastError = editor->list.lastHistoryError();
+            return EDITOR_IO_ERROR;
+        }
+        return EDITOR_NO_MORE_STEPS;
+    });
+}
+
+EditorStatus editorCountMatches(Editor* editor, const char* text, int ignoreCase, size_t* count) {
+    return guard(editor, [&] {
+        if (!text || !*text || !count) {
+            return EDITOR_INVALID_ARGUMENT;
+        }
+        ostringstream discarded;
+        BufferedOutput out(discarded);
+        MatchReporter reporter(out, SearchMode::CountOnly);
+        editor->list.searchMatches(text, ignoreCase != 0, reporter);
+        *count = reporter.matchCount();
+        return EDITOR_OK;
+    });
+}
+
+EditorStatus editorLineCount(const Editor* editor, size_t* count) {
+    if (!editor || !count) {
+        return EDITOR_INVALID_ARGUMENT;
+    }
+    *count = editor->list.lineCount();
+    return EDITOR_OK;
+}
+
+EditorStatus editorGetLine(Editor* editor, size_t line, char* buffer, size_t capacity, size_t* length) {
+    return guard(editor, [&] {
+        string text;
+        if (!fitsInt(line) || !editor->list.getLine(static_cast<int>(line), text)) {
+            return EDITOR_OUT_OF_RANGE;
+        }
+        return copyOut(text, buffer, capacity, length);
+    });
+}
+
+EditorStatus editorGetText(Editor* editor, char* buffer, size_t capacity, size_t* length) {
+    return guard(editor, [&] {
+        ostringstream text;
+        editor->list.writeText(text);
+        return copyOut(text.str(), buffer, capacity, length);
+    });
+}
+
+} // extern "C"
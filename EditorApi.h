@@ -0,0 +1,113 @@
+#ifndef EDITORAPI_H
+#define EDITORAPI_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// C interface to the editing engine for programs that embed it. Every call returns a status code;
+// text is returned by copying it into a buffer the caller owns, together with its length.
+// An Editor must not be used from two threads at the same time.
+// Text passed to an edit must not contain '\n': such calls return EDITOR_INVALID_ARGUMENT and change
+// nothing. Start a new line with editorNewLine, or load a file to get text that spans lines.
+
+typedef struct Editor Editor;
+
+typedef enum EditorStatus {
+    EDITOR_OK = 0,
+    EDITOR_INVALID_ARGUMENT, // a null pointer, an unknown value or text with '\n'
+    EDITOR_OUT_OF_RANGE,     // a line or position outside of the text
+    EDITOR_NO_MORE_STEPS,    // nothing to undo or redo
+    EDITOR_IO_ERROR,         // a file could not be read or written, see editorLastError
+    EDITOR_BUFFER_TOO_SMALL, // the length that is needed was stored, the buffer was not touched
+    EDITOR_ERROR             // anything else, e.g. an invalid regular expression
+} EditorStatus;
+
+typedef enum EditorEditKind {
+    EDITOR_EDIT_INSERT,
+    EDITOR_EDIT_DELETE,
+    EDITOR_EDIT_REPLACE
+} EditorEditKind;
+
+// One edit of a batch; positions refer to the text before the batch
+typedef struct EditorEdit {
+    EditorEditKind kind;
+    size_t line;
+    size_t position;
+    size_t count;     // characters to delete
+    const char* text; // text to insert or to write over the old one
+} EditorEdit;
+
+// Flags of editorReplaceAll
+enum {
+    EDITOR_REGEX = 1,
+    EDITOR_IGNORE_CASE = 2
+};
+
+Editor* editorCreate(void);
+void editorDestroy(Editor* editor);
+
+// Message of the last call that failed, empty if there was none
+const char* editorLastError(const Editor* editor);
+
+// A lazily opened file stays mapped and its lines are loaded as they are reached
+EditorStatus editorLoad(Editor* editor, const char* path, int lazily);
+EditorStatus editorSave(Editor* editor, const char* path);
+
+// On a lazily opened file these load all lines that were not loaded yet
+EditorStatus editorAppend(Editor* editor, const char* text);
+EditorStatus editorNewLine(Editor* editor);
+EditorStatus editorInsert(Editor* editor, size_t line, size_t position, const char* text);
+EditorStatus editorDelete(Editor* editor, size_t line, size_t position, size_t count);
+EditorStatus editorReplace(Editor* editor, size_t line, size_t position, const char* text);
+EditorStatus editorCut(Editor* editor, size_t line, size_t position, size_t count);
+EditorStatus editorCopy(Editor* editor, size_t line, size_t position, size_t count);
+EditorStatus editorPaste(Editor* editor, size_t line, size_t position);
+EditorStatus editorReplaceAll(Editor* editor, const char* pattern, const char* replacement, int flags, size_t* replaced);
+
+// Writes only the lines changed since path was last loaded or saved when it can, otherwise the whole
+// file. bytesWritten and isFullRewrite may be null.
+EditorStatus editorSaveChanges(Editor* editor, const char* path, size_t* bytesWritten, int* isFullRewrite);
+
+// Write-ahead journal of the edits at path. With recover, the edits an earlier session left there
+// are replayed first and replayed (may be null) receives their number.
+EditorStatus editorStartJournal(Editor* editor, const char* path, int recover, size_t* replayed);
+// For a clean exit: removes the journal and the other files the session kept on disk.
+// Destroying the editor without it leaves the journal behind, as a crash would.
+EditorStatus editorCloseSession(Editor* editor);
+
+// Applies all edits as one undo step, or none of them when one is out of range or they overlap
+EditorStatus editorApplyEdits(Editor* editor, const EditorEdit* edits, size_t count);
+
+// EDITOR_IO_ERROR when the step was kept on disk and could not be read back; the step is dropped
+// Cursors for editing at several places at once; they are dropped when the text changes otherwise.
+// Typing and erasing at the cursors is one undo step and moves every cursor by what changed before it.
+EditorStatus editorAddCursor(Editor* editor, size_t line, size_t position);
+EditorStatus editorCursorCount(const Editor* editor, size_t* count);
+EditorStatus editorGetCursor(const Editor* editor, size_t index, size_t* line, size_t* position);
+EditorStatus editorTypeAtCursors(Editor* editor, const char* text);
+EditorStatus editorEraseBeforeCursors(Editor* editor, size_t count);
+EditorStatus editorEraseAfterCursors(Editor* editor, size_t count);
+EditorStatus editorClearCursors(Editor* editor);
+
+EditorStatus editorUndo(Editor* editor);
+EditorStatus editorRedo(Editor* editor);
+
+// An empty text is EDITOR_INVALID_ARGUMENT, as for editorReplaceAll
+EditorStatus editorCountMatches(Editor* editor, const char* text, int ignoreCase, size_t* count);
+
+// Lines in memory; lines of a lazily opened file count once they were loaded
+EditorStatus editorLineCount(const Editor* editor, size_t* count);
+
+// Copy a line, or the whole text with '\n' after every line, into buffer followed by '\0'.
+// length receives the size without the '\0'; pass a null buffer to ask for it.
+EditorStatus editorGetLine(Editor* editor, size_t line, char* buffer, size_t capacity, size_t* length);
+EditorStatus editorGetText(Editor* editor, char* buffer, size_t capacity, size_t* length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EDITORAPI_H
@@ -6,6 +6,13 @@
 #include <fstream>
 #include <stdexcept>
 #include <vector>
+#include <string_view>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -41,4 +48,81 @@ public:
     }
 };
 
+// ChunkReader hands out a file piece by piece for callers that stream instead of loading it whole
+class ChunkReader {
+private:
+    ifstream file;
+
+public:
+    explicit ChunkReader(const string& filePath) : file(filePath, ios::in | ios::binary) {
+        if (!file.is_open()) {
+            throw runtime_error("File not found: " + filePath);
+        }
+    }
+
+    // Returns the number of bytes read, 0 at the end of the file
+    size_t readChunk(char* buffer, size_t size) {
+        if (file.eof()) {
+            return 0;
+        }
+        file.read(buffer, size);
+        return file.gcount();
+    }
+};
+
+// MappedFile exposes a whole file as read-only memory without copying it
+class MappedFile {
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    string content; // no mmap here, fall back to reading the file
+#endif
+
+public:
+    explicit MappedFile(const string& filePath) {
+#ifdef _WIN32
+        content = FileReader().read(filePath);
+        data = content.data();
+        size = content.size();
+#else
+        int descriptor = open(filePath.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw runtime_error("File not found: " + filePath);
+        }
+        struct stat info;
+        if (fstat(descriptor, &info) != 0) {
+            close(descriptor);
+            throw runtime_error("Unable to read file: " + filePath);
+        }
+        size = info.st_size;
+        if (size > 0) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (mapping == MAP_FAILED) {
+                close(descriptor);
+                throw runtime_error("Unable to map file: " + filePath);
+            }
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+        }
+        close(descriptor);
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    string_view view() const {
+        return string_view(data, size);
+    }
+};
+
 #endif // FILEREADER_H
\ No newline at end of file
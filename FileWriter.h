@@ -5,6 +5,13 @@
 #include <string>
 #include <fstream>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -35,6 +42,72 @@ public:
 
         file.close();
     }
+
+    // Writes several pieces one after another, e.g. edited lines followed by a mapped file region
+    void writeParts(const string& filePath, const vector<string_view>& parts) {
+        ofstream file(filePath, ios::out | ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Unable to open file: " + filePath);
+        }
+        for (string_view part : parts) {
+            file.write(part.data(), part.size());
+        }
+        file.close();
+        if (!file) {
+            throw runtime_error("Unable to write file: " + filePath);
+        }
+    }
+};
+
+#ifndef _WIN32
+// RangeFileWriter sizes a file up front and fills disjoint byte ranges of it with pwrite,
+// so several threads can write their parts at the same time.
+// With keepContents the existing bytes stay in place and only the written ranges change.
+class RangeFileWriter {
+private:
+    int descriptor;
+    const string path;
+
+public:
+    RangeFileWriter(const string& filePath, uint64_t totalSize, bool keepContents = false) : path(filePath) {
+        descriptor = open(filePath.c_str(), O_WRONLY | O_CREAT | (keepContents ? 0 : O_TRUNC), 0644);
+        if (descriptor < 0) {
+            throw runtime_error("Unable to open file: " + filePath);
+        }
+        if (ftruncate(descriptor, totalSize) != 0) {
+            ::close(descriptor);
+            throw runtime_error("Unable to resize file: " + filePath);
+        }
+    }
+
+    ~RangeFileWriter() {
+        if (descriptor >= 0) {
+            ::close(descriptor);
+        }
+    }
+
+    RangeFileWriter(const RangeFileWriter&) = delete;
+    RangeFileWriter& operator=(const RangeFileWriter&) = delete;
+
+    void writeAt(uint64_t offset, string_view data) {
+        while (!data.empty()) {
+            ssize_t written = pwrite(descriptor, data.data(), data.size(), offset);
+            if (written <= 0) {
+                throw runtime_error("Unable to write file: " + path);
+            }
+            data.remove_prefix(written);
+            offset += written;
+        }
+    }
+
+    void close() {
+        if (descriptor >= 0 && ::close(descriptor) != 0) {
+            descriptor = -1;
+            throw runtime_error("Unable to write file: " + path);
+        }
+        descriptor = -1;
+    }
 };
+#endif
 
 #endif // FILEWRITER_H
@@ -0,0 +1,98 @@
+#ifndef GAPBUFFER_H
+#define GAPBUFFER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+// Text with a movable gap at the editing position: inserts and deletes next to the gap
+// only touch the gap edges, moving the gap costs the distance it moves
+class GapBuffer {
+private:
+    vector<char> buffer;
+    size_t gapStart = 0;
+    size_t gapEnd = 0;
+
+    size_t gapSize() const {
+        return gapEnd - gapStart;
+    }
+
+    void grow(size_t needed) {
+        size_t tailSize = buffer.size() - gapEnd;
+        size_t newCapacity = max(buffer.size() * 2, size() + needed + 64);
+        vector<char> grown(newCapacity);
+        memcpy(grown.data(), buffer.data(), gapStart);
+        memcpy(grown.data() + newCapacity - tailSize, buffer.data() + gapEnd, tailSize);
+        gapEnd = newCapacity - tailSize;
+        buffer.swap(grown);
+    }
+
+public:
+    // Replaces the content and puts the gap at the given position
+    void load(string_view text, size_t position) {
+        buffer.assign(text.size() + 64, '\0');
+        memcpy(buffer.data(), text.data(), text.size());
+        gapStart = text.size();
+        gapEnd = buffer.size();
+        moveGap(position);
+    }
+
+    void moveGap(size_t position) {
+        position = min(position, size());
+        if (position < gapStart) {
+            size_t count = gapStart - position;
+            memmove(buffer.data() + gapEnd - count, buffer.data() + position, count);
+            gapStart -= count;
+            gapEnd -= count;
+        } else if (position > gapStart) {
+            size_t count = position - gapStart;
+            memmove(buffer.data() + gapStart, buffer.data() + gapEnd, count);
+            gapStart += count;
+            gapEnd += count;
+        }
+    }
+
+    void insert(string_view text) {
+        if (gapSize() < text.size()) {
+            grow(text.size());
+        }
+        memcpy(buffer.data() + gapStart, text.data(), text.size());
+        gapStart += text.size();
+    }
+
+    // Removes up to count characters before the gap, returns how many were removed
+    size_t eraseBefore(size_t count) {
+        count = min(count, gapStart);
+        gapStart -= count;
+        return count;
+    }
+
+    // Removes up to count characters after the gap, returns how many were removed
+    size_t eraseAfter(size_t count) {
+        count = min(count, buffer.size() - gapEnd);
+        gapEnd += count;
+        return count;
+    }
+
+    size_t size() const {
+        return buffer.size() - gapSize();
+    }
+
+    size_t position() const {
+        return gapStart;
+    }
+
+    string toString() const {
+        string text;
+        text.reserve(size());
+        text.append(buffer.data(), gapStart);
+        text.append(buffer.data() + gapEnd, buffer.size() - gapEnd);
+        return text;
+    }
+};
+
+#endif // GAPBUFFER_H
@@ -0,0 +1,95 @@
+#ifndef LAZYFILE_H
+#define LAZYFILE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "FileReader.h"
+#include "LineIndexer.h"
+
+using namespace std;
+
+// LazyFile keeps a file mapped so its lines can be turned into list nodes only when needed.
+// A background thread counts the lines and records where each one starts.
+class LazyFile {
+private:
+    const string path;
+    MappedFile file;
+    vector<uint64_t> lineStarts;
+    mutable mutex indexMutex;
+    atomic<bool> isIndexDone{false};
+    atomic<bool> isStopped{false};
+    thread indexer;
+
+    void buildIndex() {
+        string_view text = file.view();
+        const size_t batchSize = 1 << 20;
+        vector<uint64_t> batch;
+        if (!text.empty()) {
+            batch.push_back(0);
+        }
+        for (size_t start = 0; start < text.size() && !isStopped; start += batchSize) {
+            size_t end = min(text.size(), start + batchSize);
+            size_t firstNew = batch.size();
+            LineIndexer::findNewlines(text.data(), start, end, batch);
+            // Newline positions become the starts of the lines after them
+            for (size_t i = firstNew; i < batch.size(); i++) {
+                batch[i]++;
+            }
+            if (!batch.empty() && batch.back() == text.size()) {
+                batch.pop_back();
+            }
+            lock_guard<mutex> lock(indexMutex);
+            lineStarts.insert(lineStarts.end(), batch.begin(), batch.end());
+            batch.clear();
+        }
+        isIndexDone = true;
+    }
+
+public:
+    explicit LazyFile(const string& filePath) : path(filePath), file(filePath) {
+        indexer = thread(&LazyFile::buildIndex, this);
+    }
+
+    ~LazyFile() {
+        isStopped = true;
+        indexer.join();
+    }
+
+    LazyFile(const LazyFile&) = delete;
+    LazyFile& operator=(const LazyFile&) = delete;
+
+    const string& filePath() const {
+        return path;
+    }
+
+    string_view view() const {
+        return file.view();
+    }
+
+    bool isIndexed() const {
+        return isIndexDone;
+    }
+
+    // Lines counted so far; the total once isIndexed() is true
+    size_t indexedLines() const {
+        lock_guard<mutex> lock(indexMutex);
+        return lineStarts.size();
+    }
+
+    // Where the line with the given number starts, if the index has reached it
+    bool lineStart(size_t lineNumber, uint64_t& offset) const {
+        lock_guard<mutex> lock(indexMutex);
+        if (lineNumber >= lineStarts.size()) {
+            return false;
+        }
+        offset = lineStarts[lineNumber];
+        return true;
+    }
+};
+
+#endif // LAZYFILE_H
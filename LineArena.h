@@ -0,0 +1,168 @@
+#ifndef LINEARENA_H
+#define LINEARENA_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <memory>
+#include <string>
+
+using namespace std;
+
+// LineArena hands out memory for the nodes and line bytes of one document.
+// Small blocks are carved from 64 KB slabs and recycled through per-size free lists,
+// larger blocks come from the heap. Everything is released at once when the arena dies.
+class LineArena {
+private:
+    static const size_t slabSize = 64 * 1024;
+    static const size_t granularity = 16;
+    static const size_t maxSmallSize = 512;
+
+    struct FreeBlock {
+        FreeBlock* next;
+    };
+
+    // Header in front of every large block so they can be found on release
+    struct LargeBlock {
+        LargeBlock* previous;
+        LargeBlock* next;
+        size_t size;
+        size_t padding;
+    };
+
+    vector<unique_ptr<char[]>> slabs;
+    char* slabCursor = nullptr;
+    char* slabEnd = nullptr;
+    FreeBlock* freeLists[maxSmallSize / granularity] = {};
+    LargeBlock* largeBlocks = nullptr;
+    size_t reservedBytes = 0;
+
+    static size_t sizeClass(size_t bytes) {
+        return (bytes + granularity - 1) / granularity - 1;
+    }
+
+public:
+    LineArena() = default;
+    LineArena(const LineArena&) = delete;
+    LineArena& operator=(const LineArena&) = delete;
+
+    ~LineArena() {
+        while (largeBlocks) {
+            LargeBlock* next = largeBlocks->next;
+            free(largeBlocks);
+            largeBlocks = next;
+        }
+    }
+
+    void* allocate(size_t bytes) {
+        if (bytes == 0) {
+            bytes = 1;
+        }
+        if (bytes > maxSmallSize) {
+            LargeBlock* block = static_cast<LargeBlock*>(malloc(sizeof(LargeBlock) + bytes));
+            if (!block) {
+                throw bad_alloc();
+            }
+            block->previous = nullptr;
+            block->next = largeBlocks;
+            block->size = bytes;
+            if (largeBlocks) {
+                largeBlocks->previous = block;
+            }
+            largeBlocks = block;
+            reservedBytes += bytes;
+            return block + 1;
+        }
+
+        size_t index = sizeClass(bytes);
+        if (freeLists[index]) {
+            FreeBlock* block = freeLists[index];
+            freeLists[index] = block->next;
+            return block;
+        }
+        size_t rounded = (index + 1) * granularity;
+        if (slabCursor + rounded > slabEnd) {
+            slabs.emplace_back(new char[slabSize]);
+            slabCursor = slabs.back().get();
+            slabEnd = slabCursor + slabSize;
+            reservedBytes += slabSize;
+        }
+        void* block = slabCursor;
+        slabCursor += rounded;
+        return block;
+    }
+
+    void deallocate(void* pointer, size_t bytes) {
+        if (bytes == 0) {
+            bytes = 1;
+        }
+        if (bytes > maxSmallSize) {
+            LargeBlock* block = static_cast<LargeBlock*>(pointer) - 1;
+            if (block->previous) {
+                block->previous->next = block->next;
+            } else {
+                largeBlocks = block->next;
+            }
+            if (block->next) {
+                block->next->previous = block->previous;
+            }
+            reservedBytes -= block->size;
+            free(block);
+            return;
+        }
+        size_t index = sizeClass(bytes);
+        FreeBlock* block = static_cast<FreeBlock*>(pointer);
+        block->next = freeLists[index];
+        freeLists[index] = block;
+    }
+
+    size_t bytesReserved() const {
+        return reservedBytes;
+    }
+};
+
+// Standard allocator over a LineArena; without an arena it falls back to the heap
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = false_type;
+    using propagate_on_container_move_assignment = false_type;
+    using propagate_on_container_swap = false_type;
+    using is_always_equal = false_type;
+
+    LineArena* arena;
+
+    ArenaAllocator(LineArena* arena = nullptr) noexcept : arena(arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(size_t count) {
+        size_t bytes = count * sizeof(T);
+        return static_cast<T*>(arena ? arena->allocate(bytes) : ::operator new(bytes));
+    }
+
+    void deallocate(T* pointer, size_t count) {
+        if (arena) {
+            arena->deallocate(pointer, count * sizeof(T));
+        } else {
+            ::operator delete(pointer);
+        }
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+};
+
+using LineString = basic_string<char, char_traits<char>, ArenaAllocator<char>>;
+
+#endif // LINEARENA_H
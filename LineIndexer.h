@@ -0,0 +1,115 @@
+#ifndef LINEINDEXER_H
+#define LINEINDEXER_H
+
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+// Finds where the lines of a buffer start. Large buffers are split into chunks that are
+// scanned for newlines on separate threads, the per-chunk results are stitched together.
+class LineIndexer {
+public:
+    // Appends the position of every '\n' in [begin, end), 16 bytes at a time where SIMD is available
+    static void findNewlines(const char* data, size_t begin, size_t end, vector<uint64_t>& positions) {
+        size_t i = begin;
+#if defined(__SSE2__)
+        const __m128i newline = _mm_set1_epi8('\n');
+        for (; i + 16 <= end; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+            unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, newline));
+            while (mask) {
+                positions.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        const uint8x16_t newline = vdupq_n_u8('\n');
+        for (; i + 16 <= end; i += 16) {
+            uint8x16_t block = vld1q_u8(reinterpret_cast<const uint8_t*>(data + i));
+            if (vmaxvq_u8(vceqq_u8(block, newline)) == 0) {
+                continue;
+            }
+            for (size_t j = i; j < i + 16; j++) {
+                if (data[j] == '\n') {
+                    positions.push_back(j);
+                }
+            }
+        }
+#endif
+        for (; i < end; i++) {
+            if (data[i] == '\n') {
+                positions.push_back(i);
+            }
+        }
+    }
+
+    // Start offsets of all lines, split like getline does: a final '\n' does not open another line
+    static vector<uint64_t> lineStarts(string_view text, size_t threadCount = thread::hardware_concurrency()) {
+        const size_t minChunkSize = 1 << 20;
+        threadCount = max<size_t>(1, min(threadCount, text.size() / minChunkSize));
+
+        vector<vector<uint64_t>> chunkStarts(threadCount);
+        size_t chunkSize = (text.size() + threadCount - 1) / threadCount;
+        auto scanChunk = [&](size_t chunk) {
+            size_t begin = min(text.size(), chunk * chunkSize);
+            size_t end = min(text.size(), begin + chunkSize);
+            vector<uint64_t>& starts = chunkStarts[chunk];
+            findNewlines(text.data(), begin, end, starts);
+            // Turn newline positions into the starts of the lines that follow them
+            for (uint64_t& position : starts) {
+                position++;
+            }
+            if (!starts.empty() && starts.back() == text.size()) {
+                starts.pop_back();
+            }
+        };
+
+        if (threadCount == 1) {
+            scanChunk(0);
+        } else {
+            vector<thread> workers;
+            for (size_t chunk = 0; chunk < threadCount; chunk++) {
+                workers.emplace_back(scanChunk, chunk);
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        size_t total = text.empty() ? 0 : 1;
+        for (const auto& starts : chunkStarts) {
+            total += starts.size();
+        }
+        vector<uint64_t> result;
+        result.reserve(total);
+        if (!text.empty()) {
+            result.push_back(0);
+        }
+        for (const auto& starts : chunkStarts) {
+            result.insert(result.end(), starts.begin(), starts.end());
+        }
+        return result;
+    }
+
+    // Line number lineIndex without its '\n'
+    static string_view line(string_view text, const vector<uint64_t>& starts, size_t lineIndex) {
+        size_t begin = starts[lineIndex];
+        size_t end = lineIndex + 1 < starts.size() ? starts[lineIndex + 1] - 1 : text.size();
+        if (lineIndex + 1 == starts.size() && end > begin && text[end - 1] == '\n') {
+            end--;
+        }
+        return text.substr(begin, end - begin);
+    }
+};
+
+#endif // LINEINDEXER_H
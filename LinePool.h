@@ -0,0 +1,45 @@
+#ifndef LINEPOOL_H
+#define LINEPOOL_H
+
+#include <string_view>
+#include <unordered_set>
+#include <cstring>
+#include "LineArena.h"
+
+using namespace std;
+
+// LinePool keeps one immutable copy of every distinct line it has seen.
+// The bytes live in the pool's own arena and stay valid until the pool is destroyed.
+class LinePool {
+private:
+    LineArena bytes;
+    unordered_set<string_view> lines;
+    size_t internedCount = 0;
+
+public:
+    // Returns the shared copy of a line; the pointer is stable for the lifetime of the pool
+    const string_view* intern(string_view text) {
+        internedCount++;
+        auto found = lines.find(text);
+        if (found != lines.end()) {
+            return &*found;
+        }
+        char* copy = static_cast<char*>(bytes.allocate(text.size()));
+        memcpy(copy, text.data(), text.size());
+        return &*lines.insert(string_view(copy, text.size())).first;
+    }
+
+    size_t distinctLines() const {
+        return lines.size();
+    }
+
+    size_t internedLines() const {
+        return internedCount;
+    }
+
+    size_t bytesReserved() const {
+        return bytes.bytesReserved();
+    }
+};
+
+#endif // LINEPOOL_H
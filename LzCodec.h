@@ -0,0 +1,144 @@
+#ifndef LZCODEC_H
+#define LZCODEC_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+using namespace std;
+
+// Small LZ77 codec in the style of LZ4: every sequence is a token byte (literal length in the
+// high nibble, match length - 4 in the low nibble), optional length extension bytes, the literals,
+// and a 2-byte match offset. The last sequence has literals only.
+class LzCodec {
+private:
+    static const size_t minMatch = 4;
+    static const size_t hashBits = 12;
+    static const size_t maxOffset = 65535;
+
+    static uint32_t read32(const char* data) {
+        uint32_t value;
+        memcpy(&value, data, sizeof(value));
+        return value;
+    }
+
+    static size_t hash(uint32_t value) {
+        return (value * 2654435761u) >> (32 - hashBits);
+    }
+
+    static void writeLength(string& out, size_t length) {
+        while (length >= 255) {
+            out += static_cast<char>(255);
+            length -= 255;
+        }
+        out += static_cast<char>(length);
+    }
+
+    static size_t readLength(string_view in, size_t& position, size_t length) {
+        if (length != 15) {
+            return length;
+        }
+        unsigned char extra;
+        do {
+            if (position >= in.size()) {
+                throw runtime_error("Compressed block is truncated");
+            }
+            extra = in[position++];
+            length += extra;
+        } while (extra == 255);
+        return length;
+    }
+
+    static void writeSequence(string& out, string_view literals, size_t offset, size_t matchLength) {
+        size_t literalCode = literals.size() < 15 ? literals.size() : 15;
+        size_t matchCode = 0;
+        if (matchLength) {
+            matchCode = matchLength - minMatch < 15 ? matchLength - minMatch : 15;
+        }
+        out += static_cast<char>((literalCode << 4) | matchCode);
+        if (literalCode == 15) {
+            writeLength(out, literals.size() - 15);
+        }
+        out.append(literals.data(), literals.size());
+        if (matchLength) {
+            out += static_cast<char>(offset & 0xFF);
+            out += static_cast<char>(offset >> 8);
+            if (matchCode == 15) {
+                writeLength(out, matchLength - minMatch - 15);
+            }
+        }
+    }
+
+public:
+    static string compress(string_view in) {
+        string out;
+        out.reserve(in.size() / 2 + 16);
+        vector<uint32_t> table(size_t(1) << hashBits, 0);
+        size_t anchor = 0;
+        size_t position = 0;
+
+        while (in.size() >= minMatch && position + minMatch <= in.size()) {
+            uint32_t sequence = read32(in.data() + position);
+            size_t slot = hash(sequence);
+            size_t candidate = table[slot];
+            table[slot] = static_cast<uint32_t>(position);
+
+            if (candidate < position && position - candidate <= maxOffset && read32(in.data() + candidate) == sequence) {
+                size_t length = minMatch;
+                while (position + length < in.size() && in[candidate + length] == in[position + length]) {
+                    length++;
+                }
+                writeSequence(out, in.substr(anchor, position - anchor), position - candidate, length);
+                position += length;
+                anchor = position;
+            } else {
+                position++;
+            }
+        }
+        writeSequence(out, in.substr(anchor), 0, 0);
+        return out;
+    }
+
+    static string decompress(string_view in, size_t rawSize) {
+        string out;
+        out.reserve(rawSize);
+        size_t position = 0;
+
+        while (position < in.size()) {
+            unsigned char token = in[position++];
+            size_t literalLength = readLength(in, position, token >> 4);
+            if (position + literalLength > in.size()) {
+                throw runtime_error("Compressed block is truncated");
+            }
+            out.append(in.data() + position, literalLength);
+            position += literalLength;
+            if (position >= in.size()) {
+                break; // the last sequence has no match
+            }
+
+            if (position + 2 > in.size()) {
+                throw runtime_error("Compressed block is truncated");
+            }
+            size_t offset = static_cast<unsigned char>(in[position]) | (static_cast<unsigned char>(in[position + 1]) << 8);
+            position += 2;
+            size_t matchLength = readLength(in, position, token & 0x0F) + minMatch;
+            if (offset == 0 || offset > out.size()) {
+                throw runtime_error("Compressed block is corrupted");
+            }
+            // Byte by byte, a match may overlap the bytes it produces
+            size_t from = out.size() - offset;
+            for (size_t i = 0; i < matchLength; i++) {
+                out += out[from + i];
+            }
+        }
+        if (out.size() != rawSize) {
+            throw runtime_error("Compressed block has an unexpected size");
+        }
+        return out;
+    }
+};
+
+#endif // LZCODEC_H
@@ -0,0 +1,73 @@
+#ifndef MACRORECORDER_H
+#define MACRORECORDER_H
+
+#include <istream>
+#include <streambuf>
+#include <string>
+
+using namespace std;
+
+// Keeps a copy of everything the menu reads from a stream while recording, so the commands
+// that were typed can be parsed as a script and replayed later.
+class MacroRecorder : public streambuf {
+private:
+    istream& input;
+    streambuf* source = nullptr; // the stream's own buffer while recording
+    string recorded;
+    size_t markedSize = 0;
+
+protected:
+    // No buffer of its own: every character is taken from the source one by one and copied when consumed
+    int_type underflow() override {
+        return source->sgetc();
+    }
+
+    int_type uflow() override {
+        int_type next = source->sbumpc();
+        if (!traits_type::eq_int_type(next, traits_type::eof())) {
+            recorded.push_back(traits_type::to_char_type(next));
+        }
+        return next;
+    }
+
+public:
+    explicit MacroRecorder(istream& input) : input(input) {}
+
+    ~MacroRecorder() {
+        stop();
+    }
+
+    MacroRecorder(const MacroRecorder&) = delete;
+    MacroRecorder& operator=(const MacroRecorder&) = delete;
+
+    void start() {
+        if (!source) {
+            recorded.clear();
+            markedSize = 0;
+            source = input.rdbuf(this);
+        }
+    }
+
+    bool isRecording() const {
+        return source != nullptr;
+    }
+
+    // Remembers where the next command starts; stop() keeps the recording up to here
+    void mark() {
+        markedSize = recorded.size();
+    }
+
+    // Returns what was read up to the last mark
+    string stop() {
+        if (source) {
+            input.rdbuf(source);
+            source = nullptr;
+        }
+        string macro = recorded.substr(0, markedSize);
+        recorded.clear();
+        markedSize = 0;
+        return macro;
+    }
+};
+
+#endif // MACRORECORDER_H
@@ -0,0 +1,206 @@
+#ifndef MENUCOMMANDS_H
+#define MENUCOMMANDS_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <charconv>
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+// A command of the menu. arguments lists what the menu asks for after the command number, in order:
+// 'n' a number (numbers asked together may share a line), 't' a line of text, 'y' a yes/no answer,
+// 'm' a search result mode, followed by the number of matches when the mode is 3.
+struct MenuCommand {
+    int number;
+    const char* name;
+    const char* arguments;
+};
+
+inline const vector<MenuCommand>& menuCommands() {
+    static const vector<MenuCommand> commands = {
+        {1, "Append at the end", "t"},
+        {2, "Start a new line", ""},
+        {3, "Save to file", "t"},
+        {4, "Load from file", "t"},
+        {5, "Print to console", ""},
+        {6, "Insert text by line and index", "nnt"},
+        {7, "Search", "tym"},
+        {8, "Clear console and display menu", ""},
+        {9, "Delete text by line and index", "nnn"},
+        {10, "Exit", ""},
+        {11, "Undo last change", ""},
+        {12, "Redo last undone change", ""},
+        {13, "Cut text by line and index", "nnn"},
+        {14, "Copy text by line and index", "nnn"},
+        {15, "Paste text by line and index", "nn"},
+        {16, "Insert with replacement by line and index", "nnt"},
+        {17, "Encrypt/Decrypt file (Normal Mode)", "nttn"},
+        {18, "Encrypt file (Secret Mode)", "tt"},
+        {19, "Search in encrypted file", "tntm"},
+        {20, "Search in all files of a directory", "ttym"},
+        {21, "Replace all occurrences", "ttyy"},
+        {22, "Move cursor", "nn"},
+        {23, "Type at cursor", "t"},
+        {24, "Delete before cursor (backspace)", "n"},
+        {25, "Delete after cursor", "n"},
+        {26, "Toggle sharing of identical lines", ""},
+        {27, "Compress lines that were not used recently", "n"},
+        {28, "Open large file lazily", "t"},
+        {29, "Show lazily opened file status", ""},
+        {30, "Save to file in parallel (large documents)", "t"},
+        {31, "Save only the changed lines", "t"},
+        {32, "Configure autosave", "tn"},
+        {33, "Show autosave status", ""},
+        {34, "Show edit journal status", ""},
+        {35, "Configure undo history limits", "nn"},
+        {36, "Show undo history statistics", ""},
+        {37, "Group consecutive appends and inserts for undo", "n"},
+        {38, "Start or finish an undo group", ""},
+        {39, "Toggle keeping older undo steps on disk", ""},
+        {40, "Toggle undo tree (keeps every branch)", ""},
+        {41, "Show versions of the undo tree", ""},
+        {42, "Jump to a version of the undo tree", "n"},
+        {43, "Apply a batch of edits from a file", "t"},
+        {44, "Start or stop recording a macro", ""},
+        {45, "Replay the macro N times", "n"},
+        {46, "Replay the macro at every line containing a text", "ty"},
+        {47, "Add a cursor", "nn"},
+        {48, "Add cursors at every match of a text", "tyy"},
+        {49, "Type at all cursors", "t"},
+        {50, "Delete before all cursors (backspace)", "n"},
+        {51, "Delete after all cursors", "n"},
+        {52, "Remove all cursors", ""},
+    };
+    return commands;
+}
+
+inline const MenuCommand* findMenuCommand(int number) {
+    for (const MenuCommand& command : menuCommands()) {
+        if (command.number == number) {
+            return &command;
+        }
+    }
+    return nullptr;
+}
+
+// A menu command with its arguments. Numbers and texts are kept in the order the menu asks for them;
+// yes/no answers count as texts, a search mode as two numbers: the mode and the number of matches.
+struct ScriptCommand {
+    int number = 0;
+    size_t line = 0; // line of the script the command starts on
+    vector<long long> numbers;
+    vector<string> texts;
+};
+
+// Reads a script of menu commands: the same input the menu reads, a command number followed by
+// its arguments. Empty lines and lines starting with '#' are skipped where a command number is expected.
+class CommandScript {
+private:
+    vector<string> lines;
+    size_t row = 0;
+    size_t column = 0;
+
+    [[noreturn]] void fail(const string& message) const {
+        throw runtime_error("Script line " + to_string(min(row, lines.size()) + 1) + ": " + message);
+    }
+
+    long long readNumber() {
+        while (row < lines.size()) {
+            const string& current = lines[row];
+            while (column < current.size() && isspace(static_cast<unsigned char>(current[column]))) {
+                column++;
+            }
+            if (column == current.size()) {
+                row++;
+                column = 0;
+                continue;
+            }
+            long long value = 0;
+            auto [end, error] = from_chars(current.data() + column, current.data() + current.size(), value);
+            if (error != errc() || (end != current.data() + current.size() && !isspace(static_cast<unsigned char>(*end)))) {
+                fail("number expected");
+            }
+            column = end - current.data();
+            return value;
+        }
+        fail("number expected");
+    }
+
+    // The rest of a line that held numbers is ignored, like the menu does
+    void endLine() {
+        if (column > 0) {
+            row++;
+            column = 0;
+        }
+    }
+
+    string readText() {
+        if (row >= lines.size()) {
+            fail("text expected");
+        }
+        return lines[row++];
+    }
+
+    void skipComments() {
+        while (row < lines.size() && column == 0 &&
+               (lines[row].find_first_not_of(" \t") == string::npos || lines[row][0] == '#')) {
+            row++;
+        }
+    }
+
+public:
+    explicit CommandScript(istream& input) {
+        string text;
+        while (getline(input, text)) {
+            if (!text.empty() && text.back() == '\r') {
+                text.pop_back();
+            }
+            lines.push_back(move(text));
+        }
+    }
+
+    vector<ScriptCommand> parse() {
+        vector<ScriptCommand> commands;
+        row = 0;
+        column = 0;
+        for (skipComments(); row < lines.size(); skipComments()) {
+            ScriptCommand command;
+            command.line = row + 1;
+            command.number = static_cast<int>(readNumber());
+            endLine();
+            const MenuCommand* menuCommand = findMenuCommand(command.number);
+            if (!menuCommand) {
+                row = command.line - 1;
+                fail("unknown command " + to_string(command.number));
+            }
+            for (const char* argument = menuCommand->arguments; *argument; argument++) {
+                switch (*argument) {
+                    case 'n':
+                        command.numbers.push_back(readNumber());
+                        if (argument[1] != 'n') {
+                            endLine();
+                        }
+                        break;
+                    case 'm':
+                        command.numbers.push_back(readNumber());
+                        endLine();
+                        command.numbers.push_back(command.numbers.back() == 3 ? readNumber() : 0);
+                        endLine();
+                        break;
+                    default:
+                        command.texts.push_back(readText());
+                        break;
+                }
+            }
+            commands.push_back(move(command));
+        }
+        return commands;
+    }
+};
+
+#endif // MENUCOMMANDS_H
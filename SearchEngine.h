@@ -0,0 +1,185 @@
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <array>
+#include "CaseFolding.h"
+#include "BufferedOutput.h"
+
+using namespace std;
+
+// Literal substring search: memchr skips to candidates for the first byte, memcmp confirms them.
+// With ignoreCase the pattern is folded once and the text is folded on the fly while comparing.
+// An empty pattern matches nowhere; the commands reject it before searching.
+class TextSearcher {
+private:
+    string needle;
+    bool ignoreCase;
+    bool isAsciiNeedle = true;
+    array<bool, 256> leadBytes{}; // bytes that can start a case-insensitive UTF-8 match
+
+    size_t findExact(string_view haystack, size_t from) const {
+        const char* begin = haystack.data();
+        const char* current = begin + from;
+        const char* last = begin + haystack.size() - needle.size();
+        const char first = needle[0];
+
+        while (current <= last) {
+            const void* hit = memchr(current, first, last - current + 1);
+            if (!hit) {
+                return string_view::npos;
+            }
+            current = static_cast<const char*>(hit);
+            if (memcmp(current + 1, needle.data() + 1, needle.size() - 1) == 0) {
+                return current - begin;
+            }
+            current++;
+        }
+        return string_view::npos;
+    }
+
+    size_t findFoldedUtf8(string_view haystack, size_t from) const {
+        const size_t last = haystack.size() - needle.size();
+        for (size_t i = from; i <= last; i++) {
+            if (leadBytes[static_cast<unsigned char>(haystack[i])] && CaseFolding::equalsFoldedUtf8(haystack, i, needle)) {
+                return i;
+            }
+        }
+        return string_view::npos;
+    }
+
+public:
+    explicit TextSearcher(const string& pattern, bool ignoreCase = false) : needle(pattern), ignoreCase(ignoreCase) {
+        if (!ignoreCase) {
+            return;
+        }
+        needle = CaseFolding::foldUtf8(pattern);
+        isAsciiNeedle = CaseFolding::isAscii(needle);
+        if (!isAsciiNeedle) {
+            // Collect the first byte of every character that folds to the first pattern character
+            char32_t first;
+            CaseFolding::decodeUtf8(needle.data(), needle.size(), first);
+            for (char32_t code = 0; code < 0x500; code++) {
+                if (CaseFolding::foldCodePoint(code) == first) {
+                    string encoded;
+                    CaseFolding::appendUtf8(encoded, code);
+                    leadBytes[static_cast<unsigned char>(encoded[0])] = true;
+                }
+            }
+            leadBytes[static_cast<unsigned char>(needle[0])] = true;
+        }
+    }
+
+    const string& pattern() const {
+        return needle;
+    }
+
+    // Case folding keeps character lengths, so every match is as long as the pattern
+    size_t matchLength() const {
+        return needle.size();
+    }
+
+    size_t find(string_view haystack, size_t from = 0) const {
+        if (needle.empty() || from >= haystack.size() || haystack.size() - from < needle.size()) {
+            return string_view::npos;
+        }
+        if (!ignoreCase) {
+            return findExact(haystack, from);
+        }
+        if (isAsciiNeedle) {
+            return CaseFolding::findFoldedAscii(haystack, from, needle);
+        }
+        return findFoldedUtf8(haystack, from);
+    }
+};
+
+enum class SearchMode {
+    FullLines,      // every match with the whole line, as the search always did
+    CountOnly,      // only the number of matches
+    FirstN,         // full lines, stopping after a limit
+    PositionsOnly   // "line:position" pairs without line content
+};
+
+// Formats matches for the chosen mode into a BufferedOutput
+class MatchReporter {
+private:
+    BufferedOutput& out;
+    SearchMode mode;
+    size_t limit;
+    size_t matches = 0;
+    string_view prefix;
+
+public:
+    MatchReporter(BufferedOutput& out, SearchMode mode, size_t limit = 0) : out(out), mode(mode), limit(limit) {}
+
+    // Text printed in front of every match, e.g. the file a match comes from
+    void setPrefix(string_view text) {
+        prefix = text;
+    }
+
+    // Returns false once no more matches are wanted
+    bool report(size_t lineNumber, size_t position, string_view line) {
+        matches++;
+        switch (mode) {
+            case SearchMode::CountOnly:
+                return true;
+            case SearchMode::PositionsOnly:
+                out << prefix << lineNumber << ':' << position << '\n';
+                return true;
+            case SearchMode::FirstN:
+            case SearchMode::FullLines:
+                out << prefix << "Found on line " << lineNumber << " at position " << position << ": " << line << '\n';
+                break;
+        }
+        return !isLimitReached();
+    }
+
+    // Whether matches are printed together with their line content
+    bool showsLines() const {
+        return mode == SearchMode::FullLines || mode == SearchMode::FirstN;
+    }
+
+    bool isLimitReached() const {
+        return mode == SearchMode::FirstN && matches >= limit;
+    }
+
+    size_t matchCount() const {
+        return matches;
+    }
+
+    void finish() {
+        if (matches == 0) {
+            out << "Text not found!\n";
+        } else if (mode == SearchMode::CountOnly) {
+            out << "Found " << matches << " occurrence(s)\n";
+        }
+        out.flush();
+    }
+};
+
+// Reports every match in a buffer of '\n'-separated lines, numbering them from firstLineNumber.
+// Returns false once the reporter does not want more matches.
+inline bool searchLines(string_view text, size_t firstLineNumber, const TextSearcher& searcher, MatchReporter& reporter) {
+    size_t lineNumber = firstLineNumber;
+    size_t lineStart = 0;
+    size_t position = searcher.find(text);
+    while (position != string_view::npos) {
+        // Advance the line counter up to the match
+        const void* newline;
+        while ((newline = memchr(text.data() + lineStart, '\n', position - lineStart)) != nullptr) {
+            lineNumber++;
+            lineStart = static_cast<const char*>(newline) - text.data() + 1;
+        }
+        const void* lineEndHit = memchr(text.data() + position, '\n', text.size() - position);
+        size_t lineEnd = lineEndHit ? static_cast<const char*>(lineEndHit) - text.data() : text.size();
+        if (!reporter.report(lineNumber, position - lineStart, text.substr(lineStart, lineEnd - lineStart))) {
+            return false;
+        }
+        position = searcher.find(text, position + 1);
+    }
+    return true;
+}
+
+#endif // SEARCHENGINE_H
@@ -0,0 +1,103 @@
+#ifndef SPILLLOG_H
+#define SPILLLOG_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <cstdint>
+#include "LzCodec.h"
+
+using namespace std;
+
+// Stack of compressed records in a temporary file. Records are appended at the end and taken back
+// from the end, which shrinks the file again, so only the offsets of the records stay in memory.
+class SpillLog {
+private:
+    struct Record {
+        uint64_t offset;
+        uint64_t size;
+        uint64_t rawSize;
+    };
+
+    string path;
+    vector<Record> records;
+    uint64_t fileSize = 0;
+
+    static string makePath() {
+        static atomic<unsigned> counter{0};
+        string name = "editor-history-" + to_string(random_device{}()) + "-" + to_string(counter++) + ".log";
+        return (filesystem::temp_directory_path() / name).string();
+    }
+
+public:
+    SpillLog() : path(makePath()) {}
+
+    ~SpillLog() {
+        error_code error;
+        filesystem::remove(path, error);
+    }
+
+    SpillLog(const SpillLog&) = delete;
+    SpillLog& operator=(const SpillLog&) = delete;
+
+    void push(string_view raw) {
+        string compressed = LzCodec::compress(raw);
+        ofstream file(path, ios::out | ios::binary | ios::app);
+        file.write(compressed.data(), compressed.size());
+        file.close();
+        if (!file) {
+            throw runtime_error("Unable to write file: " + path);
+        }
+        records.push_back({fileSize, compressed.size(), raw.size()});
+        fileSize += compressed.size();
+    }
+
+    // Reads the newest record back and removes it from the file. The record is removed even when
+    // it cannot be read, so the ones before it can still be taken back.
+    string pop() {
+        Record record = records.back();
+        string compressed(record.size, '\0');
+        ifstream file(path, ios::in | ios::binary);
+        file.seekg(record.offset);
+        file.read(compressed.data(), compressed.size());
+        bool isRead = static_cast<bool>(file);
+        file.close();
+        records.pop_back();
+        // A file that could not be shrunk keeps the record as dead bytes, later ones are appended after it
+        error_code error;
+        filesystem::resize_file(path, record.offset, error);
+        if (!error) {
+            fileSize = record.offset;
+        }
+        if (!isRead) {
+            throw runtime_error("Unable to read file: " + path);
+        }
+        return LzCodec::decompress(compressed, record.rawSize);
+    }
+
+    void clear() {
+        records.clear();
+        fileSize = 0;
+        error_code error;
+        filesystem::remove(path, error);
+    }
+
+    bool isEmpty() const {
+        return records.empty();
+    }
+
+    size_t size() const {
+        return records.size();
+    }
+
+    uint64_t bytesOnDisk() const {
+        return fileSize;
+    }
+};
+
+#endif // SPILLLOG_H
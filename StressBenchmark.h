@@ -0,0 +1,74 @@
+#ifndef STRESSBENCHMARK_H
+#define STRESSBENCHMARK_H
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include "TextDocument.h"
+#include "SearchEngine.h"
+
+using namespace std;
+
+// Builds, copies, searches and tears down a document with a given number of lines
+// and prints how long every step took. Run with: Assignment2_Paradigms --stress <lines>
+class StressBenchmark {
+private:
+    using Clock = chrono::steady_clock;
+
+    static void report(const string& step, Clock::time_point start) {
+        double milliseconds = chrono::duration<double, milli>(Clock::now() - start).count();
+        cout << step << ": " << milliseconds << " ms" << endl;
+    }
+
+public:
+    static void run(size_t lineCount) {
+        cout << "Stress test with " << lineCount << " lines" << endl;
+
+        auto start = Clock::now();
+        TextDocument document;
+        document.setFirst("line 0 of the stress document");
+        for (size_t i = 1; i < lineCount; i++) {
+            document.append("line " + to_string(i) + " of the stress document");
+        }
+        report("Build", start);
+        cout << "Arena size: " << document.bytesReserved() / (1024 * 1024) << " MB" << endl;
+
+        start = Clock::now();
+        TextDocument snapshot = document.clone();
+        report("Snapshot copy", start);
+
+        start = Clock::now();
+        TextSearcher searcher("99 of");
+        size_t matches = 0;
+        for (TextNode* current = document.first(); current; current = current->next.get()) {
+            if (searcher.find(current->text()) != string_view::npos) {
+                matches++;
+            }
+        }
+        report("Search (" + to_string(matches) + " lines matched)", start);
+
+        start = Clock::now();
+        document = TextDocument();
+        report("Replace document", start);
+
+        start = Clock::now();
+        snapshot = TextDocument();
+        report("Drop snapshot", start);
+
+        // A list outside of any arena is torn down node by node, which must not recurse
+        start = Clock::now();
+        NodePtr heapHead(new TextNode("", nullptr));
+        TextNode* heapTail = heapHead.get();
+        for (size_t i = 1; i < lineCount; i++) {
+            heapTail->next.reset(new TextNode("heap line", nullptr));
+            heapTail = heapTail->next.get();
+        }
+        report("Build heap list", start);
+
+        start = Clock::now();
+        heapHead.reset();
+        report("Tear down heap list", start);
+    }
+};
+
+#endif // STRESSBENCHMARK_H
@@ -0,0 +1,690 @@
+#ifndef TEXTDOCUMENT_H
+#define TEXTDOCUMENT_H
+
+#include <string>
+#include <string_view>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include "LineArena.h"
+#include "LinePool.h"
+#include "LzCodec.h"
+#include "LazyFile.h"
+#include "LineIndexer.h"
+#include <thread>
+
+using namespace std;
+
+class TextNode;
+class ColdBlock;
+
+// Counts editor commands so lines can tell how long ago they were last used
+class AccessClock {
+public:
+    static uint32_t& now() {
+        static uint32_t tick = 0;
+        return tick;
+    }
+
+    static void advance() {
+        now()++;
+    }
+};
+
+// Destroys a node together with the rest of its list and gives the memory back to the arena
+// it came from. The list is walked in a loop, so long lists do not recurse once per line.
+struct NodeDeleter {
+    void operator()(TextNode* node) const;
+};
+
+using NodePtr = unique_ptr<TextNode, NodeDeleter>;
+
+// A line either owns its content, points at an immutable copy in a LinePool,
+// or sits compressed in a ColdBlock until it is used again.
+// Shared lines are copied into content the first time they are edited.
+class TextNode {
+public:
+    LineString content;
+    NodePtr next;
+    const string_view* shared = nullptr;
+    ColdBlock* cold = nullptr;
+    uint32_t touched = AccessClock::now(); // when the line was last edited
+    uint32_t coldIndex = 0;                // position of the line in its cold block
+
+    TextNode(string_view content, LineArena* arena) : content(content, ArenaAllocator<char>(arena)), next(nullptr) {}
+
+    LineArena* arena() const {
+        return content.get_allocator().arena;
+    }
+
+    // Reading a cold line leaves it compressed, only edit and setText bring it back for good
+    string_view text();
+    size_t length() const;
+    LineString& edit();
+    void setText(string_view text);
+
+    // Content of a line that is not cold, without marking it as used, e.g. for a writer on another thread
+    string_view peek() const {
+        return shared ? *shared : string_view(content);
+    }
+
+    void share(const string_view* pooled) {
+        shared = pooled;
+        content.clear();
+        content.shrink_to_fit();
+    }
+};
+
+// Compressed content of consecutive lines that have not been edited for a while.
+// Reading a line decodes the block into a buffer that is kept while the block is read often
+// and dropped again by forgetDecoded; editing any of the lines decompresses the whole block
+// back into its nodes.
+class ColdBlock {
+public:
+    shared_ptr<const string> compressed; // shared with the copies in history snapshots
+    vector<uint32_t> lengths;
+    vector<TextNode*> nodes;
+    size_t rawSize = 0;
+    string decoded;          // the raw lines while they are being read, empty otherwise
+    vector<size_t> offsets;  // where each line starts in decoded
+    uint32_t lastRead = 0;   // AccessClock tick of the last read
+
+    bool isThawed() const {
+        return nodes.empty();
+    }
+
+    bool isDecoded() const {
+        return !offsets.empty();
+    }
+
+    string_view read(uint32_t index) {
+        lastRead = AccessClock::now();
+        if (offsets.empty()) {
+            decoded = LzCodec::decompress(*compressed, rawSize);
+            offsets.resize(lengths.size());
+            size_t offset = 0;
+            for (size_t i = 0; i < lengths.size(); i++) {
+                offsets[i] = offset;
+                offset += lengths[i];
+            }
+        }
+        return string_view(decoded).substr(offsets[index], lengths[index]);
+    }
+
+    // Views returned by read are invalid afterwards
+    void forgetDecoded() {
+        decoded.clear();
+        decoded.shrink_to_fit();
+        offsets.clear();
+        offsets.shrink_to_fit();
+    }
+
+    void thaw() {
+        string raw = offsets.empty() ? LzCodec::decompress(*compressed, rawSize) : move(decoded);
+        forgetDecoded();
+        size_t offset = 0;
+        for (size_t i = 0; i < nodes.size(); i++) {
+            nodes[i]->content.assign(raw.data() + offset, lengths[i]);
+            nodes[i]->cold = nullptr;
+            offset += lengths[i];
+        }
+        nodes.clear();
+        nodes.shrink_to_fit();
+        lengths.clear();
+        lengths.shrink_to_fit();
+        compressed.reset();
+    }
+};
+
+inline string_view TextNode::text() {
+    if (cold) {
+        return cold->read(coldIndex);
+    }
+    return shared ? *shared : string_view(content);
+}
+
+inline size_t TextNode::length() const {
+    return cold ? cold->lengths[coldIndex] : peek().size();
+}
+
+inline LineString& TextNode::edit() {
+    if (cold) {
+        cold->thaw();
+    }
+    touched = AccessClock::now();
+    if (shared) {
+        content.assign(shared->data(), shared->size());
+        shared = nullptr;
+    }
+    return content;
+}
+
+inline void TextNode::setText(string_view text) {
+    if (cold) {
+        cold->thaw();
+    }
+    touched = AccessClock::now();
+    shared = nullptr;
+    content.assign(text.data(), text.size());
+}
+
+// Reads lines without decoding into their cold blocks. A pass over the whole document holds one
+// decoded block at a time this way, and threads can read a document that none of them changes.
+// A view it returns is valid until the next read; lines are cheapest to read in order.
+class ColdLineReader {
+private:
+    const ColdBlock* block = nullptr;
+    string decoded;
+    uint32_t nextIndex = 0;
+    size_t nextOffset = 0;
+
+public:
+    string_view read(const TextNode* node) {
+        const ColdBlock* cold = node->cold;
+        if (!cold) {
+            return node->peek();
+        }
+        if (cold->isDecoded()) {
+            return string_view(cold->decoded).substr(cold->offsets[node->coldIndex], cold->lengths[node->coldIndex]);
+        }
+        if (cold != block) {
+            decoded = LzCodec::decompress(*cold->compressed, cold->rawSize);
+            block = cold;
+            nextIndex = 0;
+            nextOffset = 0;
+        }
+        if (node->coldIndex != nextIndex) {
+            nextOffset = 0;
+            for (uint32_t i = 0; i < node->coldIndex; i++) {
+                nextOffset += cold->lengths[i];
+            }
+        }
+        string_view line = string_view(decoded).substr(nextOffset, cold->lengths[node->coldIndex]);
+        nextIndex = node->coldIndex + 1;
+        nextOffset += line.size();
+        return line;
+    }
+};
+
+inline void NodeDeleter::operator()(TextNode* node) const {
+    while (node) {
+        TextNode* next = node->next.release();
+        LineArena* arena = node->arena();
+        node->~TextNode();
+        if (arena) {
+            arena->deallocate(node, sizeof(TextNode));
+        } else {
+            ::operator delete(node);
+        }
+        node = next;
+    }
+}
+
+// TextDocument owns a list of lines together with the arena that holds their nodes and bytes.
+// Replacing or destroying a document drops the arena as a whole instead of freeing line by line.
+class TextDocument {
+private:
+    unique_ptr<LineArena> arena;
+    shared_ptr<LinePool> pool; // set when identical lines are stored once
+    NodePtr head;
+    TextNode* tail = nullptr;
+    size_t lineCount = 0;
+    vector<unique_ptr<ColdBlock>> coldBlocks;
+    vector<unique_ptr<LineArena>> extraArenas; // arenas of lines that were built on other threads
+
+    // Lines of a mapped file that have not been turned into nodes yet
+    shared_ptr<LazyFile> lazyFile;
+    size_t lazyOffset = 0; // where the next unloaded line starts
+    size_t lazyLine = 0;   // its line number in the file
+
+    // Where the last lookup by line number stopped. Lines are only ever added at the end,
+    // so a node keeps its line number for as long as the document lives.
+    TextNode* seekNode = nullptr;
+    size_t seekLine = 0;
+
+    TextNode* appendLine(string_view content) {
+        tail->next = newNode(content);
+        tail = tail->next.get();
+        lineCount++;
+        return tail;
+    }
+
+    string_view takeLazyLine() {
+        string_view text = lazyFile->view();
+        size_t start = lazyOffset;
+        size_t end;
+        uint64_t nextStart;
+        if (lazyFile->lineStart(lazyLine + 1, nextStart)) {
+            end = nextStart - 1;
+        } else {
+            const void* newline = memchr(text.data() + start, '\n', text.size() - start);
+            end = newline ? static_cast<const char*>(newline) - text.data() : text.size();
+        }
+        lazyOffset = min(end + 1, text.size());
+        lazyLine++;
+        return text.substr(start, end - start);
+    }
+
+    // Every node and line byte lives in the arena, so the list is released without visiting it
+    void releaseLines() {
+        head.release();
+        arena.reset();
+        extraArenas.clear();
+        pool.reset();
+        coldBlocks.clear();
+        lazyFile.reset();
+        seekNode = nullptr;
+    }
+
+    // Compresses a run of lines into one block unless compression does not pay off
+    void freeze(const vector<TextNode*>& run) {
+        string raw;
+        auto block = make_unique<ColdBlock>();
+        for (TextNode* node : run) {
+            raw.append(node->content.data(), node->content.size());
+            block->lengths.push_back(static_cast<uint32_t>(node->content.size()));
+        }
+        string compressed = LzCodec::compress(raw);
+        if (compressed.size() >= raw.size() - raw.size() / 10) {
+            for (TextNode* node : run) {
+                node->touched = AccessClock::now(); // do not retry these lines on every pass
+            }
+            return;
+        }
+        block->rawSize = raw.size();
+        block->compressed = make_shared<const string>(move(compressed));
+        block->nodes = run;
+        for (size_t i = 0; i < run.size(); i++) {
+            run[i]->content.clear();
+            run[i]->content.shrink_to_fit();
+            run[i]->cold = block.get();
+            run[i]->coldIndex = static_cast<uint32_t>(i);
+        }
+        coldBlocks.push_back(move(block));
+    }
+
+public:
+    TextDocument() : arena(make_unique<LineArena>()) {
+        head = newNode("");
+        tail = head.get();
+        lineCount = 1;
+    }
+
+    ~TextDocument() {
+        releaseLines();
+    }
+
+    TextDocument(TextDocument&& other) noexcept
+        : arena(move(other.arena)), pool(move(other.pool)), head(move(other.head)), tail(other.tail),
+          lineCount(other.lineCount), coldBlocks(move(other.coldBlocks)), extraArenas(move(other.extraArenas)), lazyFile(move(other.lazyFile)),
+          lazyOffset(other.lazyOffset), lazyLine(other.lazyLine), seekNode(other.seekNode), seekLine(other.seekLine) {
+        other.tail = nullptr;
+        other.lineCount = 0;
+        other.seekNode = nullptr;
+    }
+
+    TextDocument& operator=(TextDocument&& other) noexcept {
+        if (this != &other) {
+            releaseLines();
+            arena = move(other.arena);
+            pool = move(other.pool);
+            head = move(other.head);
+            tail = other.tail;
+            lineCount = other.lineCount;
+            coldBlocks = move(other.coldBlocks);
+            extraArenas = move(other.extraArenas);
+            lazyFile = move(other.lazyFile);
+            lazyOffset = other.lazyOffset;
+            lazyLine = other.lazyLine;
+            seekNode = other.seekNode;
+            seekLine = other.seekLine;
+            other.tail = nullptr;
+            other.lineCount = 0;
+            other.seekNode = nullptr;
+        }
+        return *this;
+    }
+
+    TextDocument(const TextDocument&) = delete;
+    TextDocument& operator=(const TextDocument&) = delete;
+
+    NodePtr newNode(string_view content = "") {
+        void* memory = arena->allocate(sizeof(TextNode));
+        if (pool) {
+            NodePtr node(new (memory) TextNode("", arena.get()));
+            node->shared = pool->intern(content);
+            return node;
+        }
+        return NodePtr(new (memory) TextNode(content, arena.get()));
+    }
+
+    // Builds a document from a buffer and its line index. Large inputs are split into line ranges
+    // that are turned into nodes on separate threads, each with its own arena, then linked together.
+    static TextDocument fromLines(string_view text, const vector<uint64_t>& starts,
+                                  size_t threadCount = thread::hardware_concurrency()) {
+        TextDocument document;
+        if (starts.empty()) {
+            return document;
+        }
+        document.setFirst(LineIndexer::line(text, starts, 0));
+
+        struct Segment {
+            unique_ptr<LineArena> arena = make_unique<LineArena>();
+            NodePtr first;
+            TextNode* last = nullptr;
+        };
+        const size_t minLinesPerThread = 1 << 16;
+        size_t remaining = starts.size() - 1;
+        threadCount = max<size_t>(1, min(threadCount, remaining / minLinesPerThread));
+        vector<Segment> segments(threadCount);
+        size_t rangeSize = (remaining + threadCount - 1) / threadCount;
+
+        auto buildSegment = [&](size_t index) {
+            Segment& segment = segments[index];
+            size_t begin = 1 + min(remaining, index * rangeSize);
+            size_t end = 1 + min(remaining, (index + 1) * rangeSize);
+            for (size_t line = begin; line < end; line++) {
+                string_view content = LineIndexer::line(text, starts, line);
+                void* memory = segment.arena->allocate(sizeof(TextNode));
+                NodePtr node(new (memory) TextNode(content, segment.arena.get()));
+                TextNode* raw = node.get();
+                if (segment.last) {
+                    segment.last->next = move(node);
+                } else {
+                    segment.first = move(node);
+                }
+                segment.last = raw;
+            }
+        };
+
+        if (threadCount == 1) {
+            buildSegment(0);
+        } else {
+            vector<thread> workers;
+            for (size_t index = 0; index < threadCount; index++) {
+                workers.emplace_back(buildSegment, index);
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        for (Segment& segment : segments) {
+            if (!segment.first) {
+                continue;
+            }
+            document.tail->next = move(segment.first);
+            document.tail = segment.last;
+            document.extraArenas.push_back(move(segment.arena));
+        }
+        document.lineCount = starts.size();
+        return document;
+    }
+
+    TextNode* first() const {
+        return head.get();
+    }
+
+    // The last line of the file: on a lazily opened file every line still waiting is loaded first,
+    // which costs O(rest of the file)
+    TextNode* last() {
+        materializeAll();
+        return tail;
+    }
+
+    // Number of lines in the list, not counting lines still waiting in a lazily opened file
+    size_t size() const {
+        return lineCount;
+    }
+
+    // Adds a line after the last one without walking the list; like last, it loads a lazy file to the end
+    TextNode* append(string_view content = "") {
+        materializeAll();
+        return appendLine(content);
+    }
+
+    // Shows a mapped file as this document; only the first line is loaded right away
+    void attachLazyFile(shared_ptr<LazyFile> file) {
+        lazyFile = move(file);
+        lazyOffset = 0;
+        lazyLine = 0;
+        if (hasLazyLines()) {
+            setFirst(takeLazyLine());
+        }
+    }
+
+    bool hasLazyLines() const {
+        return lazyFile && lazyOffset < lazyFile->view().size();
+    }
+
+    // The lines that were not loaded yet, separated by '\n' like in the file
+    string_view lazyLines() const {
+        if (!hasLazyLines()) {
+            return string_view();
+        }
+        string_view rest = lazyFile->view().substr(lazyOffset);
+        if (rest.back() == '\n') {
+            rest.remove_suffix(1);
+        }
+        return rest;
+    }
+
+    const LazyFile* lazySource() const {
+        return lazyFile.get();
+    }
+
+    // Loads lines from the lazy file until the list has a node for lineIndex
+    void materializeUpTo(size_t lineIndex) {
+        while (lineCount <= lineIndex && hasLazyLines()) {
+            appendLine(takeLazyLine());
+        }
+    }
+
+    void materializeAll() {
+        while (hasLazyLines()) {
+            appendLine(takeLazyLine());
+        }
+    }
+
+    // Node of a line, null past the end. Walks on from the previous lookup when the line is not above it,
+    // so visiting lines from top to bottom costs one pass over the list.
+    TextNode* nodeAt(size_t lineIndex) {
+        materializeUpTo(lineIndex);
+        if (lineIndex >= lineCount) {
+            return nullptr;
+        }
+        TextNode* current = head.get();
+        size_t currentLine = 0;
+        if (seekNode && seekLine <= lineIndex) {
+            current = seekNode;
+            currentLine = seekLine;
+        }
+        while (currentLine < lineIndex) {
+            current = current->next.get();
+            currentLine++;
+        }
+        seekNode = current;
+        seekLine = currentLine;
+        return current;
+    }
+
+    // Keeps the first count lines or adds empty ones up to count; a document keeps at least one line
+    void resize(size_t count) {
+        materializeAll();
+        count = max<size_t>(count, 1);
+        while (lineCount < count) {
+            appendLine("");
+        }
+        if (lineCount > count) {
+            TextNode* newTail = nodeAt(count - 1);
+            for (TextNode* current = newTail->next.get(); current; current = current->next.get()) {
+                if (current->cold) {
+                    current->cold->thaw(); // the block must not point at the dropped lines
+                }
+            }
+            newTail->next.reset();
+            tail = newTail;
+            lineCount = count;
+        }
+    }
+
+    // Sets the first line, e.g. when filling a fresh document
+    void setFirst(string_view content) {
+        if (pool) {
+            head->share(pool->intern(content));
+        } else {
+            head->setText(content);
+        }
+    }
+
+    // Copies all lines into a new document with its own arena.
+    // Pooled lines and compressed blocks are not copied, the copy points at the same shared content.
+    TextDocument clone() const {
+        TextDocument copy;
+        unordered_map<const ColdBlock*, ColdBlock*> copiedBlocks;
+        TextNode* currentDst = copy.first();
+        for (TextNode* currentSrc = head.get(); currentSrc; currentSrc = currentSrc->next.get()) {
+            if (currentSrc != head.get()) {
+                currentDst->next = copy.newNode();
+                currentDst = currentDst->next.get();
+                copy.lineCount++;
+            }
+            currentDst->touched = currentSrc->touched;
+            if (currentSrc->shared) {
+                currentDst->shared = currentSrc->shared;
+            } else if (currentSrc->cold) {
+                ColdBlock*& copied = copiedBlocks[currentSrc->cold];
+                if (!copied) {
+                    copy.coldBlocks.push_back(make_unique<ColdBlock>());
+                    copied = copy.coldBlocks.back().get();
+                    copied->compressed = currentSrc->cold->compressed;
+                    copied->lengths = currentSrc->cold->lengths;
+                    copied->rawSize = currentSrc->cold->rawSize;
+                }
+                currentDst->coldIndex = static_cast<uint32_t>(copied->nodes.size());
+                copied->nodes.push_back(currentDst);
+                currentDst->cold = copied;
+            } else {
+                currentDst->content = currentSrc->content;
+            }
+        }
+        copy.tail = currentDst;
+        copy.pool = pool;
+        copy.lazyFile = lazyFile;
+        copy.lazyOffset = lazyOffset;
+        copy.lazyLine = lazyLine;
+        return copy;
+    }
+
+    bool isInterning() const {
+        return pool != nullptr;
+    }
+
+    // Moves every line into a shared pool, so identical lines are stored once
+    void enableInterning() {
+        if (pool) {
+            return;
+        }
+        pool = make_shared<LinePool>();
+        for (TextNode* current = head.get(); current; current = current->next.get()) {
+            if (current->cold) {
+                current->cold->thaw();
+            }
+            current->share(pool->intern(current->text()));
+        }
+    }
+
+    // Gives every line its own copy again; the pool lives on while snapshots use it
+    void disableInterning() {
+        for (TextNode* current = head.get(); current; current = current->next.get()) {
+            current->edit();
+        }
+        pool.reset();
+    }
+
+    const LinePool* linePool() const {
+        return pool.get();
+    }
+
+    // Compresses runs of blockLines consecutive lines that were not used for idleTicks commands
+    void compressColdLines(uint32_t idleTicks, size_t blockLines = 256) {
+        coldBlocks.erase(remove_if(coldBlocks.begin(), coldBlocks.end(),
+                                   [](const unique_ptr<ColdBlock>& block) { return block->isThawed(); }),
+                         coldBlocks.end());
+
+        const uint32_t now = AccessClock::now();
+        vector<TextNode*> run;
+        run.reserve(blockLines);
+        for (TextNode* current = head.get(); current; current = current->next.get()) {
+            if (current->cold || current->shared || now - current->touched < idleTicks) {
+                run.clear();
+                continue;
+            }
+            run.push_back(current);
+            if (run.size() == blockLines) {
+                freeze(run);
+                run.clear();
+            }
+        }
+    }
+
+    // Drops what reading cold lines decoded, except for the most recently read blocks that fit in
+    // keepBytes; views of the dropped lines are invalid afterwards
+    void forgetDecodedLines(size_t keepBytes = 0) {
+        vector<ColdBlock*> decoded;
+        for (auto& block : coldBlocks) {
+            if (block->isDecoded()) {
+                decoded.push_back(block.get());
+            }
+        }
+        sort(decoded.begin(), decoded.end(), [](const ColdBlock* a, const ColdBlock* b) { return a->lastRead > b->lastRead; });
+        size_t kept = 0;
+        for (ColdBlock* block : decoded) {
+            kept += block->rawSize;
+            if (kept > keepBytes) {
+                block->forgetDecoded();
+            }
+        }
+    }
+
+    void decompressAll() {
+        for (auto& block : coldBlocks) {
+            if (!block->isThawed()) {
+                block->thaw();
+            }
+        }
+        coldBlocks.clear();
+    }
+
+    struct ColdStats {
+        size_t blocks = 0;
+        size_t lines = 0;
+        size_t rawBytes = 0;
+        size_t compressedBytes = 0;
+    };
+
+    ColdStats coldStats() const {
+        ColdStats stats;
+        for (const auto& block : coldBlocks) {
+            if (!block->isThawed()) {
+                stats.blocks++;
+                stats.lines += block->nodes.size();
+                stats.rawBytes += block->rawSize;
+                stats.compressedBytes += block->compressed->size();
+            }
+        }
+        return stats;
+    }
+
+    size_t bytesReserved() const {
+        size_t bytes = arena ? arena->bytesReserved() : 0;
+        for (const auto& extra : extraArenas) {
+            bytes += extra->bytesReserved();
+        }
+        return bytes;
+    }
+};
+
+#endif // TEXTDOCUMENT_H
@@ -0,0 +1,129 @@
+#ifndef TEXTEDIT_H
+#define TEXTEDIT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <istream>
+#include <sstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+
+using namespace std;
+
+// One edit of a batch. Positions refer to the document as it was before the batch.
+struct TextEdit {
+    enum class Kind : uint8_t {
+        Insert,  // text at position
+        Delete,  // count characters from position
+        Replace  // text over the characters from position
+    };
+
+    Kind kind = Kind::Insert;
+    size_t line = 0;
+    size_t position = 0;
+    size_t count = 0;
+    string text;
+
+    // Characters of the original line the edit covers, given the length of that line
+    size_t span(size_t lineLength) const {
+        size_t rest = lineLength - position;
+        switch (kind) {
+            case Kind::Delete:
+                return count < rest ? count : rest;
+            case Kind::Replace:
+                return text.size() < rest ? text.size() : rest;
+            default:
+                return 0;
+        }
+    }
+
+    // Packs a batch into one string, e.g. for a single journal record
+    static string pack(const vector<TextEdit>& edits) {
+        string out;
+        for (const TextEdit& edit : edits) {
+            put(out, static_cast<uint8_t>(edit.kind));
+            put(out, static_cast<uint64_t>(edit.line));
+            put(out, static_cast<uint64_t>(edit.position));
+            put(out, static_cast<uint64_t>(edit.count));
+            put(out, static_cast<uint32_t>(edit.text.size()));
+            out += edit.text;
+        }
+        return out;
+    }
+
+    static vector<TextEdit> unpack(string_view in) {
+        vector<TextEdit> edits;
+        while (!in.empty()) {
+            TextEdit edit;
+            uint8_t kind;
+            uint64_t line, position, count;
+            uint32_t size;
+            if (!get(in, kind) || !get(in, line) || !get(in, position) || !get(in, count) || !get(in, size) ||
+                in.size() < size) {
+                throw runtime_error("Damaged batch of edits");
+            }
+            edit.kind = static_cast<Kind>(kind);
+            edit.line = line;
+            edit.position = position;
+            edit.count = count;
+            edit.text.assign(in.data(), size);
+            in.remove_prefix(size);
+            edits.push_back(move(edit));
+        }
+        return edits;
+    }
+
+    // Reads one edit per line: "insert <line> <position> <text>", "delete <line> <position> <count>"
+    // or "replace <line> <position> <text>". Empty lines are skipped.
+    static vector<TextEdit> parse(istream& input) {
+        vector<TextEdit> edits;
+        string row;
+        size_t rowNumber = 0;
+        while (getline(input, row)) {
+            rowNumber++;
+            if (row.empty()) {
+                continue;
+            }
+            istringstream fields(row);
+            string name;
+            TextEdit edit;
+            fields >> name >> edit.line >> edit.position;
+            if (name == "delete") {
+                edit.kind = Kind::Delete;
+                fields >> edit.count;
+            } else if (name == "insert" || name == "replace") {
+                edit.kind = name == "insert" ? Kind::Insert : Kind::Replace;
+                fields.get(); // the space before the text
+                getline(fields, edit.text);
+                fields.clear();
+            } else {
+                fields.setstate(ios::failbit);
+            }
+            if (!fields) {
+                throw runtime_error("Invalid edit on line " + to_string(rowNumber));
+            }
+            edits.push_back(move(edit));
+        }
+        return edits;
+    }
+
+private:
+    template <typename T>
+    static void put(string& out, T value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    template <typename T>
+    static bool get(string_view& in, T& value) {
+        if (in.size() < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, in.data(), sizeof(value));
+        in.remove_prefix(sizeof(value));
+        return true;
+    }
+};
+
+#endif // TEXTEDIT_H
@@ -0,0 +1,1922 @@
+#ifndef TEXTLIST_H
+#define TEXTLIST_H
+
+#include <ostream>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <regex>
+#include <thread>
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+#include <cstdint>
+#include "FileReader.h"
+#include "FileWriter.h"
+#include "SearchEngine.h"
+#include "GapBuffer.h"
+#include "TextDocument.h"
+#include "LazyFile.h"
+#include "LineIndexer.h"
+#include "AutoSaver.h"
+#include "EditJournal.h"
+#include "SpillLog.h"
+#include "UndoTree.h"
+#include "TextEdit.h"
+
+using namespace std;
+
+// Ring buffer of the most recent document states. When a push goes over the step limit or the
+// byte budget, the oldest states are dropped first. The newest state is kept even if it alone
+// is over the budget, so the last change can always be undone.
+// With spilling on, the oldest states go to a compressed log on disk instead of being dropped
+// and are read back only when undo reaches them.
+class HistoryStack {
+private:
+    struct Entry {
+        TextDocument document;
+        size_t bytes;
+    };
+
+    deque<Entry> history;
+    size_t maxSteps;
+    size_t maxBytes; // 0 means no byte budget
+    size_t retainedBytes = 0;
+    size_t evictions = 0;
+    unique_ptr<SpillLog> spilled;
+    string spillError; // why the last state could not be written to or read from disk
+
+    // Every line followed by '\n', so empty lines at the end survive the round trip
+    static string serialize(TextDocument& document) {
+        string raw;
+        for (TextNode* current = document.first(); current; current = current->next.get()) {
+            raw.append(current->text());
+            raw += '\n';
+        }
+        if (document.hasLazyLines()) {
+            raw.append(document.lazyLines());
+            raw += '\n';
+        }
+        return raw;
+    }
+
+    void enforceLimits() {
+        while (history.size() > maxSteps || (maxBytes && retainedBytes > maxBytes && history.size() > 1)) {
+            if (spilled) {
+                try {
+                    spilled->push(serialize(history.front().document));
+                    spillError.clear();
+                } catch (const exception& e) {
+                    spillError = e.what();
+                    evictions++;
+                }
+            } else {
+                evictions++;
+            }
+            retainedBytes -= history.front().bytes;
+            history.pop_front();
+        }
+    }
+
+public:
+    HistoryStack(size_t steps, size_t bytes = 0) : maxSteps(steps), maxBytes(bytes) {}
+
+    void pushState(const TextDocument& document) {
+        if (maxSteps == 0) {
+            return;
+        }
+        TextDocument copy = document.clone();
+        size_t bytes = copy.bytesReserved();
+        history.push_back({move(copy), bytes});
+        retainedBytes += bytes;
+        enforceLimits();
+    }
+
+    // Returns false when there is no state, or when the newest one was on disk and could not be
+    // read back; that state is counted as evicted and spillError tells why
+    bool popState(TextDocument& state) {
+        if (history.empty() && spilled && !spilled->isEmpty()) {
+            try {
+                string raw = spilled->pop();
+                state = TextDocument::fromLines(raw, LineIndexer::lineStarts(raw));
+                spillError.clear();
+                return true;
+            } catch (const exception& e) {
+                spillError = e.what();
+                evictions++;
+                return false;
+            }
+        }
+        if (history.empty()) return false;
+        state = move(history.back().document);
+        retainedBytes -= history.back().bytes;
+        history.pop_back();
+        return true;
+    }
+
+    bool isEmpty() const {
+        return history.empty() && (!spilled || spilled->isEmpty());
+    }
+
+    void clear() {
+        history.clear();
+        retainedBytes = 0;
+        if (spilled) {
+            spilled->clear();
+        }
+    }
+
+    // Turning spilling off drops the states that are on disk
+    void setSpilling(bool enabled) {
+        if (enabled && !spilled) {
+            spilled = make_unique<SpillLog>();
+        } else if (!enabled && spilled) {
+            evictions += spilled->size();
+            spilled.reset();
+        }
+    }
+
+    bool isSpilling() const {
+        return spilled != nullptr;
+    }
+
+    size_t spilledStates() const {
+        return spilled ? spilled->size() : 0;
+    }
+
+    uint64_t spilledBytes() const {
+        return spilled ? spilled->bytesOnDisk() : 0;
+    }
+
+    void setLimits(size_t steps, size_t bytes) {
+        maxSteps = steps;
+        maxBytes = bytes;
+        enforceLimits();
+    }
+
+    size_t size() const {
+        return history.size();
+    }
+
+    size_t stepLimit() const {
+        return maxSteps;
+    }
+
+    size_t byteBudget() const {
+        return maxBytes;
+    }
+
+    size_t bytesRetained() const {
+        return retainedBytes;
+    }
+
+    size_t evictionCount() const {
+        return evictions;
+    }
+
+    const string& lastSpillError() const {
+        return spillError;
+    }
+};
+
+class Cursor {
+public:
+    int lineIndex;
+    int charIndex;
+
+    Cursor() : lineIndex(0), charIndex(0) {}
+    Cursor(int line, int pos) : lineIndex(line), charIndex(pos) {}
+
+    // Order in the text
+    bool operator<(const Cursor& other) const {
+        return lineIndex != other.lineIndex ? lineIndex < other.lineIndex : charIndex < other.charIndex;
+    }
+
+    bool operator==(const Cursor& other) const {
+        return lineIndex == other.lineIndex && charIndex == other.charIndex;
+    }
+};
+
+// What an incremental save wrote
+struct SaveStats {
+    uint64_t bytesWritten = 0;
+    uint64_t fileSize = 0;
+    size_t patchedRanges = 0;
+    bool isFullRewrite = false;
+};
+
+// Autosave settings together with what the background thread did so far
+struct AutosaveInfo {
+    bool isOn = false;
+    string path;
+    uint32_t seconds = 0;
+    double snapshotMilliseconds = 0; // time the editor spent on the last snapshot
+    AutoSaver::Status status;
+};
+
+// Sizes of the undo history; the tree fields are set while the undo tree is on
+struct HistoryStats {
+    struct Stack {
+        size_t states = 0;
+        size_t bytes = 0;
+        size_t evicted = 0;
+        bool isSpilling = false;
+        size_t spilledStates = 0;
+        uint64_t spilledBytes = 0;
+    };
+
+    size_t stepLimit = 0;
+    size_t byteBudget = 0; // 0 means none
+    Stack undo;
+    Stack redo;
+    size_t coalescedEdits = 0;
+    bool hasTree = false;
+    size_t versions = 0;
+    size_t currentVersion = 0;
+    size_t chunks = 0;
+    uint64_t treeBytes = 0;
+};
+
+// One version of the undo tree
+struct VersionInfo {
+    size_t id = 0;
+    size_t parent = SIZE_MAX; // SIZE_MAX for the first version
+    size_t lineCount = 0;
+    size_t branches = 0;
+    bool isCurrent = false;
+};
+
+// The editing engine: a document with its history, journal and storage settings. It does no
+// console I/O; operations take their arguments and report through return values, errors that
+// come from files are thrown as runtime_error.
+class TextList {
+private:
+    TextDocument document;
+    Cursor cursor;
+
+    TextNode* findLastTextNode() {
+        return document.last();
+    }
+
+    HistoryStack undoStack{3};
+    HistoryStack redoStack{3};
+
+    // Edits that may share one undo step with the edit right before them
+    enum class EditKind { Other, Append, Insert };
+
+    // Undo coalescing: an append after an append, or an insert where the previous one ended,
+    // joins its undo step when it comes within the window; inside a transaction every edit does
+    chrono::milliseconds coalesceWindow{0};
+    EditKind lastEditKind = EditKind::Other;
+    int lastEditLine = -1;
+    size_t lastEditEnd = 0;
+    chrono::steady_clock::time_point lastEditTime;
+    int transactionDepth = 0;
+    bool isTransactionRecorded = false;
+    size_t coalescedEdits = 0;
+    string historyError; // why the last undo or redo failed, empty when there was no step left
+    bool isHistoryPaused = false; // while the journal is replayed, or for a script that never undoes
+
+    // Saves the state before an edit for undo, unless the edit joins the undo step before it
+    void recordUndo(EditKind kind = EditKind::Other, int line = -1, size_t position = 0, size_t end = 0) {
+        if (isHistoryPaused) {
+            return;
+        }
+        auto now = chrono::steady_clock::now();
+        bool joins;
+        if (transactionDepth > 0) {
+            joins = isTransactionRecorded;
+            isTransactionRecorded = true;
+        } else {
+            joins = kind != EditKind::Other && kind == lastEditKind && coalesceWindow.count() > 0 &&
+                    now - lastEditTime <= coalesceWindow &&
+                    (kind == EditKind::Append || (line == lastEditLine && position == lastEditEnd));
+        }
+        if (joins) {
+            coalescedEdits++;
+        } else if (undoTree) {
+            commitVersion();
+        } else {
+            undoStack.pushState(document);
+        }
+        redoStack.clear();
+        lastEditKind = kind;
+        lastEditLine = line;
+        lastEditEnd = end;
+        lastEditTime = now;
+    }
+
+    // Undo and redo end the current undo step, the next edit starts a new one
+    void breakUndoGroup() {
+        lastEditKind = EditKind::Other;
+        isTransactionRecorded = false;
+    }
+    string clipboardBuffer; // store copied/cut text
+
+    bool shareIdenticalLines = false;
+    uint32_t coldAfterCommands = 0; // 0 keeps every line uncompressed
+    uint32_t commandsSinceCompression = 0;
+    size_t decodedColdBudget = 16 << 20; // bytes of cold blocks that stay decoded for reading across commands
+
+    // Re-applies storage settings to a document that was just loaded or restored from history
+    void applyStorageMode() {
+        if (shareIdenticalLines) {
+            document.enableInterning();
+        } else if (document.isInterning()) {
+            // A state saved while sharing was on still shares its lines
+            document.disableInterning();
+        }
+    }
+
+    // Line under the cursor while it is being edited through the cursor commands
+    GapBuffer cursorLine;
+    TextNode* cursorNode = nullptr;
+
+    // Loads the cursor line into the gap buffer; the first edit of a session records one undo step
+    bool beginCursorEdit() {
+        if (cursorNode) {
+            return true;
+        }
+        TextNode* targetNode = findTextNodeAtIndex(cursor.lineIndex);
+        if (!targetNode || cursor.charIndex > targetNode->text().size()) {
+            return false;
+        }
+        recordUndo();
+        cursorLine.load(targetNode->text(), cursor.charIndex);
+        cursorNode = targetNode;
+        markDirty(cursor.lineIndex);
+        return true;
+    }
+
+    // Writes the edited cursor line back so the other operations see it
+    void commitCursorLine() {
+        if (cursorNode) {
+            cursorNode->setText(cursorLine.toString());
+            cursorNode = nullptr;
+        }
+    }
+
+    // Cursors of multi-cursor editing in text order, without duplicates; separate from the cursor above
+    vector<Cursor> cursors;
+
+    void sortCursors() {
+        sort(cursors.begin(), cursors.end());
+        cursors.erase(unique(cursors.begin(), cursors.end()), cursors.end());
+    }
+
+    // Deletes count characters before or after every cursor as one batch. Ranges of cursors that
+    // overlap are merged, and each cursor moves left by what was deleted before it on its line.
+    bool eraseAtCursors(size_t count, bool isBefore) {
+        commitCursorLine();
+        vector<TextEdit> edits;
+        vector<Cursor> moved = cursors;
+        size_t i = 0;
+        while (i < cursors.size()) {
+            const int line = cursors[i].lineIndex;
+            TextNode* node = findTextNodeAtIndex(line);
+            if (!node) {
+                return false;
+            }
+            const size_t length = node->text().size();
+            size_t previousEnd = 0;
+            size_t removed = 0; // characters of this line deleted so far
+            for (; i < cursors.size() && cursors[i].lineIndex == line; i++) {
+                const size_t position = cursors[i].charIndex;
+                if (position > length) {
+                    return false;
+                }
+                size_t begin = isBefore ? position - min(position, count) : position;
+                size_t end = isBefore ? position : position + min(length - position, count);
+                begin = max(begin, previousEnd);
+                // Deleted so far left of the cursor; the range of the cursor before may reach past it
+                size_t removedLeft = removed - (previousEnd > position ? previousEnd - position : 0);
+                if (begin < end) {
+                    TextEdit edit;
+                    edit.kind = TextEdit::Kind::Delete;
+                    edit.line = line;
+                    edit.position = begin;
+                    edit.count = end - begin;
+                    edits.push_back(move(edit));
+                    removed += end - begin;
+                    previousEnd = end;
+                }
+                moved[i].charIndex = static_cast<int>(position - (isBefore ? removed : removedLeft));
+            }
+        }
+        if (!applyEdits(edits)) {
+            return false;
+        }
+        cursors = move(moved);
+        sortCursors();
+        return true;
+    }
+
+    // Layout of the file as of the last load or save, so the next save can write only what changed
+    string savedPath;
+    vector<uint64_t> savedLineStarts;
+    uint64_t savedSize = 0;
+    bool savedEndsWithNewline = false;
+    filesystem::file_time_type savedWriteTime;
+    vector<pair<size_t, size_t>> dirtyRanges; // lines [begin, end) edited since then
+
+    static void addDirtyLine(vector<pair<size_t, size_t>>& ranges, size_t line) {
+        if (!ranges.empty() && ranges.back().first <= line && line <= ranges.back().second) {
+            ranges.back().second = max(ranges.back().second, line + 1);
+        } else {
+            ranges.emplace_back(line, line + 1);
+        }
+    }
+
+    // Every change of the text goes through here. Positions of the multi-cursors would be stale
+    // after it, so they are dropped; the multi-cursor edits put them back moved.
+    void markDirty(size_t line) {
+        cursors.clear();
+        editsSinceAutosave++;
+        addDirtyLine(dirtyRanges, line);
+        if (undoTree) {
+            addDirtyLine(versionDirtyRanges, line);
+        }
+    }
+
+    // For changes that may touch any line, such as undo and redo
+    void markAllDirty() {
+        cursors.clear();
+        editsSinceAutosave++;
+        dirtyRanges.assign(1, {0, SIZE_MAX});
+        if (undoTree) {
+            versionDirtyRanges.assign(1, {0, SIZE_MAX});
+        }
+    }
+
+    void rememberSavedFile(const string& filename, vector<uint64_t> lineStarts, uint64_t size, bool endsWithNewline) {
+        error_code error;
+        savedWriteTime = filesystem::last_write_time(filename, error);
+        savedPath = error ? "" : filename;
+        savedLineStarts = move(lineStarts);
+        savedSize = size;
+        savedEndsWithNewline = endsWithNewline;
+        dirtyRanges.clear();
+    }
+
+    void forgetSavedFile() {
+        savedPath.clear();
+        savedLineStarts.clear();
+        savedLineStarts.shrink_to_fit();
+        dirtyRanges.clear();
+    }
+
+    // True when filename is the file last loaded or saved and nobody else has changed it since
+    bool isSavedFileUnchanged(const string& filename) const {
+        error_code error;
+        if (savedPath.empty() || !filesystem::equivalent(filename, savedPath, error) || error) {
+            return false;
+        }
+        return filesystem::file_size(filename, error) == savedSize && !error &&
+               filesystem::last_write_time(filename, error) == savedWriteTime && !error;
+    }
+
+    uint64_t savedLineLength(size_t line) const {
+        uint64_t end = line + 1 < savedLineStarts.size() ? savedLineStarts[line + 1] - 1
+                                                         : savedSize - (savedEndsWithNewline ? 1 : 0);
+        return end - savedLineStarts[line];
+    }
+
+    // Background autosave, off while autosaveSeconds is 0
+    unique_ptr<AutoSaver> autosaver;
+    string autosavePath;
+    uint32_t autosaveSeconds = 0;
+    chrono::steady_clock::time_point lastAutosave;
+    size_t editsSinceAutosave = 0;
+    double lastSnapshotMilliseconds = 0;
+
+    // Undo tree, used instead of the undo and redo stacks while it is on
+    unique_ptr<UndoTree> undoTree;
+    size_t currentVersion = UndoTree::noVersion;
+    vector<pair<size_t, size_t>> versionDirtyRanges; // lines edited since currentVersion
+
+    // Adds the document as a new version if it was edited since the current one
+    void commitVersion() {
+        if (!versionDirtyRanges.empty()) {
+            currentVersion = undoTree->add(document, currentVersion, versionDirtyRanges);
+            versionDirtyRanges.clear();
+            pruneVersions();
+        }
+    }
+
+    // The tree keeps as many undo steps as the stacks would, besides the current version
+    void pruneVersions() {
+        undoTree->prune(currentVersion, undoStack.stepLimit() + 1, undoStack.byteBudget());
+    }
+
+    void switchToVersion(size_t id) {
+        breakUndoGroup();
+        TextDocument restored = undoTree->restore(id);
+        TextDocument previous = move(document);
+        document = move(restored);
+        applyStorageMode();
+        markAllDirty();
+        versionDirtyRanges.clear();
+        currentVersion = id;
+        undoTree->visit(id);
+        journalStateChange(previous);
+    }
+
+    // Write-ahead journal of the edits since the last load or save; null while it is off or replayed
+    unique_ptr<EditJournal> journal;
+    string journalPath;
+    size_t journalCheckpoints = 0;
+
+    void journalEdit(JournalOp op, uint64_t line = 0, uint64_t position = 0, uint64_t count = 0,
+                     string text = "", string extra = "") {
+        if (journal) {
+            journal->append(JournalRecord{op, line, position, count, move(text), move(extra)});
+        }
+    }
+
+    // Starts the journal over from a file that holds the whole document
+    void rebaseJournal(const string& basePath, bool isLazy) {
+        if (!journal) {
+            return;
+        }
+        EditJournal::syncFile(basePath);
+        JournalRecord base;
+        base.text = filesystem::absolute(basePath).string();
+        base.count = isLazy ? 1 : 0;
+        journal->restart(base);
+    }
+
+    // Writes the document out as the new base of the journal. Two base files take turns,
+    // the one the journal still points at stays intact.
+    void checkpointJournal() {
+        if (!journal) {
+            return;
+        }
+        string basePath = journalPath + ".base" + to_string(journalCheckpoints++ % 2);
+        try {
+            writeDocument(basePath);
+            rebaseJournal(basePath, false);
+        } catch (const runtime_error& e) {
+            // The journal keeps the state before; journalStats tells what went wrong
+            journal->fail(e.what());
+        }
+    }
+
+    // Undo, redo and version jumps cannot be replayed from the journal, the history is not in it.
+    // They are journaled as the lines that differ between the document before and after instead,
+    // found by comparing the two in memory. Only when the two come from different lazily opened
+    // files is the document written out as a new base.
+    void journalStateChange(TextDocument& before) {
+        if (!journal) {
+            return;
+        }
+        bool isLazy = before.hasLazyLines() || document.hasLazyLines();
+        if (isLazy && before.lazySource() != document.lazySource()) {
+            checkpointJournal();
+            return;
+        }
+        uint64_t count = 0; // with lines of the file still to read on both sides, the line count stays
+        if (before.hasLazyLines() && document.hasLazyLines()) {
+            size_t lines = max(before.size(), document.size());
+            before.materializeUpTo(lines - 1);
+            document.materializeUpTo(lines - 1);
+        } else {
+            before.materializeAll();
+            document.materializeAll();
+            count = document.size();
+        }
+        vector<pair<uint64_t, string_view>> changed;
+        TextNode* old = before.first();
+        uint64_t line = 0;
+        for (TextNode* current = document.first(); current; current = current->next.get(), line++) {
+            string_view text = current->text();
+            if (!old || old->text() != text) {
+                changed.emplace_back(line, text);
+            }
+            if (old) {
+                old = old->next.get();
+            }
+        }
+        journalEdit(JournalOp::SetLines, 0, 0, count, EditJournal::packLines(changed));
+    }
+
+    void replayJournalRecord(const JournalRecord& record) {
+        int line = static_cast<int>(record.line);
+        int position = static_cast<int>(record.position);
+        switch (record.op) {
+            case JournalOp::Base:
+                if (record.text.empty()) {
+                    recordUndo();
+                    document = TextDocument();
+                    applyStorageMode();
+                    markAllDirty();
+                    forgetSavedFile();
+                } else {
+                    loadDocument(record.text, record.count == 1);
+                }
+                break;
+            case JournalOp::AppendText:
+                appendToEnd(record.text);
+                break;
+            case JournalOp::NewLine:
+                startNewLine();
+                break;
+            case JournalOp::Insert:
+                insertText(line, position, record.text);
+                break;
+            case JournalOp::Delete:
+                deleteText(line, position, static_cast<int>(record.count));
+                break;
+            case JournalOp::Cut:
+                cutText(line, position, static_cast<int>(record.count));
+                break;
+            case JournalOp::Paste:
+                clipboardBuffer = record.text;
+                pasteText(line, position);
+                break;
+            case JournalOp::Replace:
+                replaceText(line, position, record.text);
+                break;
+            case JournalOp::MoveCursor:
+                moveCursor(line, position);
+                break;
+            case JournalOp::TypeAtCursor:
+                typeAtCursor(record.text);
+                break;
+            case JournalOp::EraseBeforeCursor:
+                eraseBeforeCursor(record.count);
+                break;
+            case JournalOp::EraseAfterCursor:
+                eraseAfterCursor(record.count);
+                break;
+            case JournalOp::ReplaceAll:
+                replaceAll(record.text, record.extra, record.count & 1, record.count & 2);
+                break;
+            case JournalOp::ApplyEdits:
+                applyEdits(TextEdit::unpack(record.text));
+                break;
+            case JournalOp::SetLines:
+                commitCursorLine();
+                recordUndo();
+                if (record.count > 0) {
+                    document.resize(record.count);
+                }
+                for (const auto& [number, text] : EditJournal::unpackLines(record.text)) {
+                    if (TextNode* node = findTextNodeAtIndex(static_cast<int>(number))) {
+                        node->setText(text);
+                    }
+                }
+                markAllDirty();
+                break;
+        }
+    }
+
+    // Patches the saved file in place; returns false when the whole file has to be written again
+    bool patchSavedFile(const string& filename, SaveStats& stats) {
+#ifdef _WIN32
+        return false;
+#else
+        if (document.hasLazyLines() || !isSavedFileUnchanged(filename)) {
+            return false;
+        }
+        const size_t lineCount = document.size();
+        const size_t savedCount = savedLineStarts.size();
+        // From this line on the layout changed and everything is written again
+        size_t firstResized = SIZE_MAX;
+        if (lineCount != savedCount) {
+            // Lines are only added at the end; the last common line gains its '\n' there
+            firstResized = max<size_t>(1, min(lineCount, savedCount)) - 1;
+        }
+
+        // Dirty lines that kept their length become patches, adjacent lines are merged into one write
+        sort(dirtyRanges.begin(), dirtyRanges.end());
+        vector<pair<uint64_t, string>> patches;
+        TextNode* node = document.first();
+        size_t nodeIndex = 0;
+        size_t nextLine = 0;
+        for (auto [begin, end] : dirtyRanges) {
+            begin = max(begin, nextLine);
+            end = min({end, lineCount, firstResized});
+            for (size_t line = begin; line < end; line++) {
+                for (; nodeIndex < line; nodeIndex++) {
+                    node = node->next.get();
+                }
+                string_view text = node->text();
+                if (text.size() != savedLineLength(line)) {
+                    firstResized = line;
+                    break;
+                }
+                uint64_t offset = savedLineStarts[line];
+                if (!patches.empty() && patches.back().first + patches.back().second.size() + 1 == offset) {
+                    patches.back().second += '\n';
+                    patches.back().second.append(text);
+                } else {
+                    patches.emplace_back(offset, string(text));
+                }
+            }
+            nextLine = max(nextLine, end);
+        }
+
+        uint64_t tailStart = savedSize;
+        uint64_t newSize = savedSize;
+        vector<string_view> tail;
+        if (firstResized != SIZE_MAX) {
+            tailStart = firstResized < savedCount ? savedLineStarts[firstResized] : savedSize;
+            // Near the end means no more than a quarter of the file is written again
+            if ((savedSize - tailStart) * 4 > savedSize) {
+                return false;
+            }
+            for (; nodeIndex < firstResized; nodeIndex++) {
+                node = node->next.get();
+            }
+            newSize = tailStart;
+            for (TextNode* current = node; current; current = current->next.get()) {
+                tail.push_back(current->text());
+                newSize += tail.back().size() + (current->next ? 1 : 0);
+            }
+        }
+
+        RangeFileWriter writer(filename, newSize, true);
+        for (const auto& [offset, bytes] : patches) {
+            writer.writeAt(offset, bytes);
+            stats.bytesWritten += bytes.size();
+        }
+        stats.patchedRanges = patches.size();
+        if (firstResized != SIZE_MAX) {
+            savedLineStarts.resize(min(firstResized, savedCount));
+            const size_t bufferSize = 4 << 20;
+            string buffer;
+            uint64_t offset = tailStart;
+            for (size_t i = 0; i < tail.size(); i++) {
+                savedLineStarts.push_back(offset + buffer.size());
+                buffer.append(tail[i].data(), tail[i].size());
+                if (i + 1 < tail.size()) {
+                    buffer += '\n';
+                }
+                if (buffer.size() >= bufferSize) {
+                    writer.writeAt(offset, buffer);
+                    offset += buffer.size();
+                    buffer.clear();
+                }
+            }
+            writer.writeAt(offset, buffer);
+            stats.bytesWritten += newSize - tailStart;
+            stats.patchedRanges++;
+            savedEndsWithNewline = false;
+        }
+        writer.close();
+        stats.fileSize = newSize;
+        rememberSavedFile(filename, move(savedLineStarts), newSize, savedEndsWithNewline);
+        rebaseJournal(filename, false);
+        return true;
+#endif
+    }
+
+    TextNode* findTextNodeAtIndex(int index) {
+        return index >= 0 ? document.nodeAt(index) : nullptr;
+    }
+
+public:
+    TextList() = default;
+
+    void setCursor(int line, int pos) {
+        cursor.lineIndex = line;
+        cursor.charIndex = pos;
+    }
+
+    bool moveCursor(int line, int pos) {
+        // Within the line being edited only the gap moves, the cursor edit goes on
+        if (cursorNode && line == cursor.lineIndex) {
+            if (pos < 0 || pos > cursorLine.size()) {
+                return false;
+            }
+            cursorLine.moveGap(pos);
+            setCursor(line, pos);
+            journalEdit(JournalOp::MoveCursor, line, pos);
+            return true;
+        }
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(line);
+        if (line < 0 || !targetNode || pos < 0 || pos > targetNode->text().size()) {
+            return false;
+        }
+        setCursor(line, pos);
+        journalEdit(JournalOp::MoveCursor, line, pos);
+        return true;
+    }
+
+    // The cursor edits return false when the cursor is outside of the text
+    bool typeAtCursor(const string& text) {
+        if (!beginCursorEdit()) {
+            return false;
+        }
+        cursorLine.insert(text);
+        cursor.charIndex = cursorLine.position();
+        journalEdit(JournalOp::TypeAtCursor, 0, 0, 0, text);
+        return true;
+    }
+
+    // Backspace: removes characters before the cursor
+    bool eraseBeforeCursor(size_t count) {
+        if (!beginCursorEdit()) {
+            return false;
+        }
+        cursorLine.eraseBefore(count);
+        cursor.charIndex = cursorLine.position();
+        journalEdit(JournalOp::EraseBeforeCursor, 0, 0, count);
+        return true;
+    }
+
+    // Delete: removes characters after the cursor
+    bool eraseAfterCursor(size_t count) {
+        if (!beginCursorEdit()) {
+            return false;
+        }
+        cursorLine.eraseAfter(count);
+        journalEdit(JournalOp::EraseAfterCursor, 0, 0, count);
+        return true;
+    }
+
+    Cursor cursorPosition() const {
+        return cursor;
+    }
+
+    // Multi-cursor editing: every edit at the cursors below is applied at all of them in one pass
+    // over the text and undone as one step. The cursors are kept apart from the single cursor;
+    // any other change of the text, undo and redo included, removes them.
+    bool addCursor(int line, int pos) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(line);
+        if (!targetNode || pos < 0 || pos > targetNode->text().size()) {
+            return false;
+        }
+        Cursor added(line, pos);
+        auto place = lower_bound(cursors.begin(), cursors.end(), added);
+        if (place == cursors.end() || !(*place == added)) {
+            cursors.insert(place, added);
+        }
+        return true;
+    }
+
+    // Adds a cursor at every match of the text, or at the start of every line with a match.
+    // Returns the number of cursors.
+    size_t addCursorsAtMatches(const string& searchText, bool ignoreCase, bool atLineStart) {
+        commitCursorLine();
+        document.materializeAll();
+        TextSearcher searcher(searchText, ignoreCase);
+        int lineNumber = 0;
+        for (TextNode* currentNode = document.first(); currentNode; currentNode = currentNode->next.get()) {
+            string_view line = currentNode->text();
+            size_t position = searcher.find(line);
+            while (position != string::npos) {
+                cursors.emplace_back(lineNumber, atLineStart ? 0 : static_cast<int>(position));
+                position = atLineStart ? string::npos : searcher.find(line, position + 1);
+            }
+            lineNumber++;
+        }
+        sortCursors();
+        return cursors.size();
+    }
+
+    const vector<Cursor>& multiCursors() const {
+        return cursors;
+    }
+
+    void clearCursors() {
+        cursors.clear();
+    }
+
+    // Inserts the text at every cursor; each cursor ends up after its copy of the text.
+    // Returns false when a cursor is outside of the text.
+    bool typeAtCursors(const string& text) {
+        commitCursorLine();
+        vector<TextEdit> edits(cursors.size());
+        for (size_t i = 0; i < cursors.size(); i++) {
+            edits[i].kind = TextEdit::Kind::Insert;
+            edits[i].line = cursors[i].lineIndex;
+            edits[i].position = cursors[i].charIndex;
+            edits[i].text = text;
+        }
+        vector<Cursor> moved = cursors;
+        if (!applyEdits(edits)) {
+            return false;
+        }
+        int line = -1;
+        int shift = 0;
+        for (Cursor& current : moved) {
+            if (current.lineIndex != line) {
+                line = current.lineIndex;
+                shift = 0;
+            }
+            shift += static_cast<int>(text.size());
+            current.charIndex += shift;
+        }
+        cursors = move(moved);
+        return true;
+    }
+
+    bool eraseBeforeCursors(size_t count) {
+        return eraseAtCursors(count, true);
+    }
+
+    bool eraseAfterCursors(size_t count) {
+        return eraseAtCursors(count, false);
+    }
+
+    // Replaces the document with a file. Opened lazily, the file stays mapped and its lines
+    // are loaded only when they are printed, searched or edited.
+    void loadDocument(const string& filename, bool lazily) {
+        commitCursorLine();
+        if (lazily) {
+            auto file = make_shared<LazyFile>(filename);
+            recordUndo();
+            document = TextDocument();
+            applyStorageMode();
+            document.attachLazyFile(move(file));
+            markAllDirty();
+            forgetSavedFile();
+        } else {
+            // The file is mapped, its newlines are found and its nodes are built on all cores
+            MappedFile file(filename);
+            vector<uint64_t> lineStarts = LineIndexer::lineStarts(file.view());
+            recordUndo();
+
+            // Replacing the existing linked list releases its arena in one go
+            document = TextDocument::fromLines(file.view(), lineStarts);
+            applyStorageMode();
+            markAllDirty();
+            string_view text = file.view();
+            rememberSavedFile(filename, move(lineStarts), text.size(), !text.empty() && text.back() == '\n');
+        }
+        editsSinceAutosave++;
+        rebaseJournal(filename, lazily);
+    }
+
+    // Lines in memory; a lazily opened file may have more that were not loaded yet
+    size_t lineCount() const {
+        return document.size();
+    }
+
+    // The file a lazily opened document still reads from, null otherwise
+    const LazyFile* lazySource() const {
+        return document.lazySource();
+    }
+
+    // Stores identical lines once; edited lines get their own copy again
+    void setLineSharing(bool enabled) {
+        commitCursorLine();
+        shareIdenticalLines = enabled;
+        if (enabled) {
+            document.enableInterning();
+        } else {
+            document.disableInterning();
+        }
+    }
+
+    bool isLineSharingEnabled() const {
+        return shareIdenticalLines;
+    }
+
+    // Pool of the shared lines, null while line sharing is off
+    const LinePool* linePool() const {
+        return document.linePool();
+    }
+
+    // Lines unused for the given number of commands are compressed in memory, 0 turns it off
+    void setColdCompression(uint32_t commands) {
+        commitCursorLine();
+        coldAfterCommands = commands;
+        commandsSinceCompression = 0;
+        if (commands == 0) {
+            document.decompressAll();
+        }
+    }
+
+    // Called once per editor command: advances the access clock, drops cold lines that were
+    // decoded for reading beyond the budget, least recently read first, and compresses lines that went cold
+    void maintainStorage() {
+        AccessClock::advance();
+        document.forgetDecodedLines(decodedColdBudget);
+        if (coldAfterCommands == 0 || ++commandsSinceCompression < coldAfterCommands) {
+            return;
+        }
+        commandsSinceCompression = 0;
+        commitCursorLine();
+        document.compressColdLines(coldAfterCommands);
+    }
+
+    // Saves a copy of the document to path every given number of seconds, 0 turns it off.
+    // The timer is only checked by autosaveIfDue, so the save happens with the first command after
+    // the interval; while the editor waits for input nothing is saved. The snapshot has to be taken
+    // on the editing thread, which is the one waiting for that input.
+    // Turning it off waits for a save that is still being written.
+    void setAutosave(const string& path, uint32_t seconds) {
+        autosavePath = path;
+        autosaveSeconds = seconds;
+        if (seconds == 0) {
+            autosaver.reset();
+            return;
+        }
+        if (!autosaver) {
+            autosaver = make_unique<AutoSaver>();
+        }
+        lastAutosave = chrono::steady_clock::now();
+    }
+
+    // Called once per editor command: when the interval has passed, a snapshot of the document
+    // is handed to the background thread and editing goes on while it is written
+    void autosaveIfDue() {
+        if (!autosaver || editsSinceAutosave == 0 || autosaver->isBusy() ||
+            chrono::steady_clock::now() - lastAutosave < chrono::seconds(autosaveSeconds)) {
+            return;
+        }
+        // The snapshot includes the line being typed without ending the cursor edit
+        if (cursorNode) {
+            cursorNode->setText(cursorLine.toString());
+        }
+        auto start = chrono::steady_clock::now();
+        autosaver->submit(document.clone(), autosavePath);
+        lastAutosave = chrono::steady_clock::now();
+        lastSnapshotMilliseconds = chrono::duration<double, milli>(lastAutosave - start).count();
+        editsSinceAutosave = 0;
+    }
+
+    AutosaveInfo autosaveInfo() const {
+        AutosaveInfo info;
+        if (autosaver) {
+            info.isOn = true;
+            info.path = autosavePath;
+            info.seconds = autosaveSeconds;
+            info.snapshotMilliseconds = lastSnapshotMilliseconds;
+            info.status = autosaver->status();
+        }
+        return info;
+    }
+
+    TextDocument::ColdStats coldStats() const {
+        return document.coldStats();
+    }
+
+    // Applies to both the undo and the redo history, and to the versions of the undo tree; a byte budget of 0 means none
+    void setHistoryLimits(size_t steps, size_t bytes) {
+        undoStack.setLimits(steps, bytes);
+        redoStack.setLimits(steps, bytes);
+        if (undoTree) {
+            pruneVersions();
+        }
+    }
+
+    // Consecutive appends, and inserts that continue one another, made within the window are undone together; 0 turns it off
+    void setUndoCoalescing(chrono::milliseconds window) {
+        coalesceWindow = window;
+        breakUndoGroup();
+    }
+
+    // Every edit between beginTransaction and the matching endTransaction is undone as one step.
+    // Transactions may nest, only the outermost one counts.
+    void beginTransaction() {
+        commitCursorLine();
+        if (transactionDepth++ == 0) {
+            isTransactionRecorded = false;
+        }
+    }
+
+    void endTransaction() {
+        commitCursorLine();
+        if (transactionDepth > 0 && --transactionDepth == 0) {
+            breakUndoGroup();
+        }
+    }
+
+    bool isInTransaction() const {
+        return transactionDepth > 0;
+    }
+
+    // Keeps states beyond the limits in a compressed log on disk, so history depth is bounded by disk space only
+    void setHistorySpilling(bool enabled) {
+        undoStack.setSpilling(enabled);
+        redoStack.setSpilling(enabled);
+    }
+
+    bool isHistorySpilling() const {
+        return undoStack.isSpilling();
+    }
+
+    // Keeps every state in an undo tree instead of the undo and redo stacks. Turning it on or off
+    // starts the history over from the current document.
+    void setUndoTree(bool enabled) {
+        commitCursorLine();
+        undoStack.clear();
+        redoStack.clear();
+        versionDirtyRanges.clear();
+        breakUndoGroup();
+        if (!enabled) {
+            undoTree.reset();
+            currentVersion = UndoTree::noVersion;
+            return;
+        }
+        undoTree = make_unique<UndoTree>();
+        currentVersion = undoTree->add(document, UndoTree::noVersion, {});
+    }
+
+    // Edits made while history is paused cannot be undone. Pausing and resuming both start the
+    // history over from the current document.
+    void setHistoryPaused(bool paused) {
+        setUndoTree(isUndoTreeEnabled());
+        isHistoryPaused = paused;
+    }
+
+    bool isUndoTreeEnabled() const {
+        return undoTree != nullptr;
+    }
+
+    // Makes a version of the undo tree the current document; the state being left is kept as a version too
+    bool jumpToVersion(size_t id) {
+        commitCursorLine();
+        if (!undoTree) {
+            return false;
+        }
+        commitVersion();
+        if (!undoTree->contains(id)) {
+            return false;
+        }
+        switchToVersion(id);
+        return true;
+    }
+
+    // The versions of the undo tree by id, empty while it is off. Pending edits become a version first.
+    vector<VersionInfo> versions() {
+        vector<VersionInfo> result;
+        if (!undoTree) {
+            return result;
+        }
+        commitCursorLine();
+        commitVersion();
+        for (size_t id = 0; id < undoTree->size(); id++) {
+            if (!undoTree->contains(id)) {
+                continue;
+            }
+            result.push_back({id, undoTree->parent(id), undoTree->lineCount(id), undoTree->childCount(id), id == currentVersion});
+        }
+        return result;
+    }
+
+    const string& lastHistoryError() const {
+        return historyError;
+    }
+
+    HistoryStats historyStats() const {
+        auto stackStats = [](const HistoryStack& history) {
+            HistoryStats::Stack stats;
+            stats.states = history.size();
+            stats.bytes = history.bytesRetained();
+            stats.evicted = history.evictionCount();
+            stats.isSpilling = history.isSpilling();
+            stats.spilledStates = history.spilledStates();
+            stats.spilledBytes = history.spilledBytes();
+            return stats;
+        };
+        HistoryStats stats;
+        stats.stepLimit = undoStack.stepLimit();
+        stats.byteBudget = undoStack.byteBudget();
+        stats.undo = stackStats(undoStack);
+        stats.redo = stackStats(redoStack);
+        stats.coalescedEdits = coalescedEdits;
+        if (undoTree) {
+            stats.hasTree = true;
+            stats.versions = undoTree->versionCount();
+            stats.currentVersion = currentVersion;
+            stats.chunks = undoTree->chunksStored();
+            stats.treeBytes = undoTree->bytesStored();
+        }
+        return stats;
+    }
+
+    // Appending and starting a new line load every line of a lazily opened file that is still waiting:
+    // new lines go after all of them. Later appends cost O(1) again.
+    void appendToEnd(const string &textToAppend) {
+        commitCursorLine();
+        recordUndo(EditKind::Append);
+        TextNode* lastNode = findLastTextNode();
+        if (lastNode->text().empty()) {
+            lastNode->setText(textToAppend);
+        } else {
+            document.append(textToAppend);
+        }
+        markDirty(document.size() - 1);
+        journalEdit(JournalOp::AppendText, 0, 0, 0, textToAppend);
+    }
+
+    void startNewLine() {
+        commitCursorLine();
+        recordUndo();
+        document.append();
+        markDirty(document.size() - 1);
+        journalEdit(JournalOp::NewLine);
+    }
+
+    void saveToFile(const string& filename) {
+        commitCursorLine();
+        FileWriter writer; // Create an instance of FileWriter
+
+        stringstream fileContent;
+        vector<uint64_t> lineStarts;
+        uint64_t offset = 0;
+        ColdLineReader reader; // one cold block decoded at a time
+        for (TextNode* current = document.first(); current; current = current->next.get()) {
+            string_view line = reader.read(current);
+            lineStarts.push_back(offset);
+            fileContent << line;
+            offset += line.size();
+            if (current->next) {
+                fileContent << '\n';
+                offset++;
+            }
+        }
+        if (document.hasLazyLines()) {
+            // Lines that were never loaded are copied straight from the mapped file. Writing over that
+            // file goes through a temporary file, the mapping keeps reading the old one.
+            string text = fileContent.str();
+            const LazyFile* source = document.lazySource();
+            bool isSourceFile = filesystem::exists(filename) && filesystem::equivalent(filename, source->filePath());
+            string target = isSourceFile ? filename + ".tmp" : filename;
+            writer.writeParts(target, {text, "\n", document.lazyLines()});
+            if (isSourceFile) {
+                filesystem::rename(target, filename);
+            }
+            forgetSavedFile();
+        } else {
+            writer.write(filename, fileContent.str()); // Use FileWriter to write to file
+            rememberSavedFile(filename, move(lineStarts), offset, false);
+        }
+        rebaseJournal(filename, false);
+    }
+
+    // Saves large documents by writing disjoint byte ranges of the file on several threads.
+    // Returns the number of bytes written.
+    uint64_t saveToFileParallel(const string& filename, size_t threadCount = thread::hardware_concurrency()) {
+        commitCursorLine();
+        vector<uint64_t> lineStarts;
+        uint64_t totalSize = writeDocument(filename, threadCount, &lineStarts);
+        if (document.hasLazyLines()) {
+            forgetSavedFile();
+        } else {
+            rememberSavedFile(filename, move(lineStarts), totalSize, false);
+        }
+        rebaseJournal(filename, false);
+        return totalSize;
+    }
+
+    // Writes the document to a file without touching the save state; lineStarts receives
+    // where the lines ended up
+    uint64_t writeDocument(const string& filename, size_t threadCount = thread::hardware_concurrency(),
+                           vector<uint64_t>* lineStarts = nullptr) {
+        commitCursorLine();
+
+        // The pieces are the lines followed by the lines that were never loaded. Cold lines are
+        // decoded block by block while they are written, each writer with its own ColdLineReader.
+        vector<const TextNode*> lines;
+        lines.reserve(document.size());
+        for (const TextNode* current = document.first(); current; current = current->next.get()) {
+            lines.push_back(current);
+        }
+        const string_view lazyLines = document.lazyLines();
+        const size_t pieceCount = lines.size() + (document.hasLazyLines() ? 1 : 0);
+        auto readPiece = [&](ColdLineReader& reader, size_t i) {
+            return i < lines.size() ? reader.read(lines[i]) : lazyLines;
+        };
+
+        // Every piece is followed by '\n' except the last one
+        vector<uint64_t> offsets(pieceCount + 1, 0);
+        for (size_t i = 0; i < pieceCount; i++) {
+            size_t size = i < lines.size() ? lines[i]->length() : lazyLines.size();
+            offsets[i + 1] = offsets[i] + size + (i + 1 < pieceCount ? 1 : 0);
+        }
+        const uint64_t totalSize = offsets.back();
+
+        const LazyFile* source = document.lazySource();
+        bool isSourceFile = source && filesystem::exists(filename) && filesystem::equivalent(filename, source->filePath());
+        string target = isSourceFile ? filename + ".tmp" : filename;
+
+#ifdef _WIN32
+        // No pwrite here, the pieces are written in order
+        ofstream file(target, ios::out | ios::binary);
+        if (!file.is_open()) {
+            throw runtime_error("Unable to open file: " + target);
+        }
+        ColdLineReader reader;
+        for (size_t i = 0; i < pieceCount; i++) {
+            string_view piece = readPiece(reader, i);
+            file.write(piece.data(), piece.size());
+            if (i + 1 < pieceCount) {
+                file.put('\n');
+            }
+        }
+        file.close();
+        if (!file) {
+            throw runtime_error("Unable to write file: " + target);
+        }
+        (void)threadCount;
+#else
+        RangeFileWriter writer(target, totalSize);
+        const uint64_t minRangeSize = 4 << 20;
+        threadCount = max<size_t>(1, min<uint64_t>(threadCount, totalSize / minRangeSize));
+
+        // Split into ranges of about the same number of bytes, on piece boundaries
+        vector<size_t> rangeStarts{0};
+        for (size_t t = 1; t < threadCount; t++) {
+            uint64_t goal = totalSize * t / threadCount;
+            size_t piece = upper_bound(offsets.begin(), offsets.end() - 1, goal) - offsets.begin() - 1;
+            rangeStarts.push_back(max(piece, rangeStarts.back()));
+        }
+        rangeStarts.push_back(pieceCount);
+
+        vector<string> errors(threadCount);
+        auto writeRange = [&](size_t range) {
+            try {
+                const size_t bufferSize = 4 << 20;
+                string buffer;
+                buffer.reserve(bufferSize);
+                uint64_t bufferOffset = offsets[rangeStarts[range]];
+                ColdLineReader reader;
+                for (size_t i = rangeStarts[range]; i < rangeStarts[range + 1]; i++) {
+                    string_view piece = readPiece(reader, i);
+                    if (buffer.size() + piece.size() + 1 > bufferSize && !buffer.empty()) {
+                        writer.writeAt(bufferOffset, buffer);
+                        bufferOffset += buffer.size();
+                        buffer.clear();
+                    }
+                    if (piece.size() >= bufferSize) {
+                        writer.writeAt(bufferOffset, piece);
+                        bufferOffset += piece.size();
+                    } else {
+                        buffer.append(piece.data(), piece.size());
+                    }
+                    if (i + 1 < pieceCount) {
+                        buffer += '\n';
+                    }
+                }
+                writer.writeAt(bufferOffset, buffer);
+            } catch (const runtime_error& e) {
+                errors[range] = e.what();
+            }
+        };
+
+        vector<thread> workers;
+        for (size_t range = 1; range < threadCount; range++) {
+            workers.emplace_back(writeRange, range);
+        }
+        writeRange(0);
+        for (thread& worker : workers) {
+            worker.join();
+        }
+        for (const string& error : errors) {
+            if (!error.empty()) {
+                throw runtime_error(error);
+            }
+        }
+        writer.close();
+#endif
+        if (isSourceFile) {
+            filesystem::rename(target, filename);
+        }
+        if (lineStarts) {
+            offsets.pop_back();
+            *lineStarts = move(offsets);
+        }
+        return totalSize;
+    }
+
+    // Saves only the lines edited since the same file was last loaded or saved. Lines that kept
+    // their length are overwritten in place and a length change near the end rewrites the tail;
+    // anything else, or a file changed by someone else, falls back to writing the whole file.
+    SaveStats saveChanges(const string& filename) {
+        commitCursorLine();
+        SaveStats stats;
+        if (patchSavedFile(filename, stats)) {
+            return stats;
+        }
+        stats.bytesWritten = saveToFileParallel(filename);
+        stats.fileSize = stats.bytesWritten;
+        stats.isFullRewrite = true;
+        return stats;
+    }
+
+    // The edit operations below return false when the position is outside of the text
+    bool insertText(int lineIndex, int charIndex, const string& text) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex > targetNode->text().size() || charIndex < 0) {
+            return false;
+        }
+        recordUndo(EditKind::Insert, lineIndex, charIndex, charIndex + text.size());
+
+        markDirty(lineIndex);
+        targetNode->edit().insert(charIndex, text);
+        journalEdit(JournalOp::Insert, lineIndex, charIndex, 0, text);
+        return true;
+    }
+
+    void searchMatches(const string& searchText, bool ignoreCase, MatchReporter& reporter) {
+        commitCursorLine();
+        TextSearcher searcher(searchText, ignoreCase);
+        size_t lineNumber = 0;
+
+        for (TextNode* currentNode = document.first(); currentNode; currentNode = currentNode->next.get()) {
+            string_view line = currentNode->text();
+            size_t position = searcher.find(line);
+            while (position != string::npos) {
+                if (!reporter.report(lineNumber, position, line)) {
+                    return;
+                }
+                // Search for the next occurrence in the same line
+                position = searcher.find(line, position + 1);
+            }
+            lineNumber++;
+        }
+        if (document.hasLazyLines()) {
+            searchLines(document.lazyLines(), lineNumber, searcher, reporter);
+        }
+    }
+
+    // Numbers of the lines that contain the text, in order and each once
+    vector<size_t> linesContaining(const string& searchText, bool ignoreCase) {
+        commitCursorLine();
+        document.materializeAll();
+        TextSearcher searcher(searchText, ignoreCase);
+        vector<size_t> lines;
+        size_t lineNumber = 0;
+        for (TextNode* currentNode = document.first(); currentNode; currentNode = currentNode->next.get()) {
+            if (searcher.find(currentNode->text()) != string::npos) {
+                lines.push_back(lineNumber);
+            }
+            lineNumber++;
+        }
+        return lines;
+    }
+
+    // Replaces every non-overlapping match in one pass and records a single undo step.
+    // Large documents are rebuilt in parallel over line ranges.
+    size_t replaceAll(const string& pattern, const string& replacement, bool useRegex, bool ignoreCase) {
+        commitCursorLine();
+        struct RangeResult {
+            vector<pair<TextNode*, string>> rebuiltLines;
+            vector<size_t> lineIndexes;
+            size_t matches = 0;
+            exception_ptr error; // e.g. a regex_error, thrown again on the calling thread
+        };
+
+        document.materializeAll();
+        vector<TextNode*> lines;
+        for (TextNode* current = document.first(); current; current = current->next.get()) {
+            lines.push_back(current);
+        }
+
+        TextSearcher searcher(pattern, ignoreCase);
+        regex expression;
+        if (useRegex) {
+            expression = regex(pattern, ignoreCase ? regex::ECMAScript | regex::icase : regex::ECMAScript);
+        }
+
+        auto rebuildLines = [&](size_t begin, size_t end, RangeResult& result) {
+            ColdLineReader reader; // the workers must not decode into blocks they share
+            for (size_t i = begin; i < end; i++) {
+                string_view line = reader.read(lines[i]);
+                string rebuilt;
+                size_t lineMatches = 0;
+                if (useRegex) {
+                    const char* last = line.data();
+                    for (cregex_iterator it(line.data(), line.data() + line.size(), expression), stop; it != stop; ++it) {
+                        rebuilt.append(last, (*it)[0].first);
+                        rebuilt += it->format(replacement);
+                        last = (*it)[0].second;
+                        lineMatches++;
+                    }
+                    if (lineMatches > 0) {
+                        rebuilt.append(last, line.data() + line.size());
+                    }
+                } else {
+                    size_t last = 0;
+                    size_t position = searcher.find(line);
+                    while (position != string::npos) {
+                        rebuilt.append(line.substr(last, position - last));
+                        rebuilt += replacement;
+                        last = position + searcher.matchLength();
+                        lineMatches++;
+                        position = searcher.find(line, last);
+                    }
+                    if (lineMatches > 0) {
+                        rebuilt.append(line.substr(last));
+                    }
+                }
+                if (lineMatches > 0) {
+                    result.rebuiltLines.emplace_back(lines[i], move(rebuilt));
+                    result.lineIndexes.push_back(i);
+                    result.matches += lineMatches;
+                }
+            }
+        };
+        // An exception must not leave a worker thread, that would end the program
+        auto rebuildRange = [&](size_t begin, size_t end, RangeResult& result) {
+            try {
+                rebuildLines(begin, end, result);
+            } catch (...) {
+                result.error = current_exception();
+            }
+        };
+
+        const size_t parallelThreshold = 1 << 14;
+        size_t threadCount = 1;
+        if (lines.size() >= parallelThreshold) {
+            threadCount = max(1u, thread::hardware_concurrency());
+        }
+        vector<RangeResult> results(threadCount);
+        if (threadCount == 1) {
+            rebuildRange(0, lines.size(), results[0]);
+        } else {
+            vector<thread> workers;
+            size_t rangeSize = (lines.size() + threadCount - 1) / threadCount;
+            for (size_t t = 0; t < threadCount; t++) {
+                size_t begin = min(lines.size(), t * rangeSize);
+                size_t end = min(lines.size(), begin + rangeSize);
+                workers.emplace_back(rebuildRange, begin, end, ref(results[t]));
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+        }
+
+        size_t totalMatches = 0;
+        for (const RangeResult& result : results) {
+            if (result.error) {
+                rethrow_exception(result.error);
+            }
+            totalMatches += result.matches;
+        }
+        if (totalMatches == 0) {
+            return 0;
+        }
+
+        recordUndo();
+        for (RangeResult& result : results) {
+            for (auto& [node, rebuilt] : result.rebuiltLines) {
+                node->setText(rebuilt);
+            }
+            for (size_t line : result.lineIndexes) {
+                markDirty(line);
+            }
+        }
+        journalEdit(JournalOp::ReplaceAll, 0, 0, (useRegex ? 1 : 0) | (ignoreCase ? 2 : 0), pattern, replacement);
+        return totalMatches;
+    }
+
+    // Writes every line followed by '\n'
+    void writeText(ostream& out) {
+        commitCursorLine();
+        ColdLineReader reader;
+        for (TextNode* current = document.first(); current; current = current->next.get()) {
+            out << reader.read(current) << '\n';
+        }
+        if (document.hasLazyLines()) {
+            out << document.lazyLines() << '\n';
+        }
+    }
+
+    bool getLine(int lineIndex, string& text) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (lineIndex < 0 || !targetNode) {
+            return false;
+        }
+        text = targetNode->text();
+        return true;
+    }
+
+    bool deleteText(int lineIndex, int charIndex, int numSymbols) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex >= targetNode->text().size() || charIndex < 0) {
+            return false;
+        }
+        recordUndo();
+
+        // Ensure we do not exceed the string's size
+        if(charIndex + numSymbols > targetNode->text().size()) {
+            numSymbols = targetNode->text().size() - charIndex;
+        }
+
+        markDirty(lineIndex);
+        targetNode->edit().erase(charIndex, numSymbols);
+        journalEdit(JournalOp::Delete, lineIndex, charIndex, numSymbols);
+        return true;
+    }
+
+    // Undo and redo return false when there is no step left, or when the step was kept on disk and
+    // could not be read back; historyError tells which
+    bool undoLastChange() {
+        commitCursorLine();
+        historyError.clear();
+        if (undoTree) {
+            commitVersion();
+            if (undoTree->parent(currentVersion) == UndoTree::noVersion) {
+                return false;
+            }
+            switchToVersion(undoTree->parent(currentVersion));
+            return true;
+        }
+        if (undoStack.isEmpty()) {
+            return false;
+        }
+        breakUndoGroup();
+        TextDocument restored;
+        if (!undoStack.popState(restored)) {
+            historyError = undoStack.lastSpillError();
+            return false;
+        }
+        redoStack.pushState(document);
+        TextDocument previous = move(document);
+        document = move(restored);
+        applyStorageMode();
+        markAllDirty();
+        journalStateChange(previous);
+        return true;
+    }
+
+    bool redoLastChange() {
+        commitCursorLine();
+        historyError.clear();
+        if (undoTree) {
+            commitVersion();
+            if (undoTree->lastChild(currentVersion) == UndoTree::noVersion) {
+                return false;
+            }
+            switchToVersion(undoTree->lastChild(currentVersion));
+            return true;
+        }
+        if (redoStack.isEmpty()) {
+            return false;
+        }
+        breakUndoGroup();
+        TextDocument restored;
+        if (!redoStack.popState(restored)) {
+            historyError = redoStack.lastSpillError();
+            return false;
+        }
+        undoStack.pushState(document);
+        TextDocument previous = move(document);
+        document = move(restored);
+        applyStorageMode();
+        markAllDirty();
+        journalStateChange(previous);
+        return true;
+    }
+
+
+    bool cutText(int lineIndex, int charIndex, int numSymbols) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex >= targetNode->text().size() || charIndex < 0) {
+            return false;
+        }
+        recordUndo();
+
+        // Ensure we do not exceed the string's size
+        if(charIndex + numSymbols > targetNode->text().size()) {
+            numSymbols = targetNode->text().size() - charIndex;
+        }
+
+        clipboardBuffer = targetNode->text().substr(charIndex, numSymbols);
+        markDirty(lineIndex);
+        targetNode->edit().erase(charIndex, numSymbols);
+        journalEdit(JournalOp::Cut, lineIndex, charIndex, numSymbols);
+        return true;
+    }
+
+    // Copies to the clipboard without changing the text
+    bool copyText(int lineIndex, int charIndex, int numSymbols) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex >= targetNode->text().size() || charIndex < 0) {
+            return false;
+        }
+
+        // Ensure we do not exceed the string's size
+        if(charIndex + numSymbols > targetNode->text().size()) {
+            numSymbols = targetNode->text().size() - charIndex;
+        }
+
+        clipboardBuffer = targetNode->text().substr(charIndex, numSymbols);
+        return true;
+    }
+
+    const string& clipboard() const {
+        return clipboardBuffer;
+    }
+
+    bool pasteText(int lineIndex, int charIndex) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex > targetNode->text().size() || charIndex < 0) {
+            return false;
+        }
+        recordUndo();
+
+        markDirty(lineIndex);
+        targetNode->edit().insert(charIndex, clipboardBuffer);
+        journalEdit(JournalOp::Paste, lineIndex, charIndex, 0, clipboardBuffer);
+        return true;
+    }
+
+    // Overwrites the characters from charIndex on with text
+    bool replaceText(int lineIndex, int charIndex, const string& text) {
+        commitCursorLine();
+        TextNode* targetNode = findTextNodeAtIndex(lineIndex);
+        if (!targetNode || charIndex < 0 || charIndex >= targetNode->text().size()) {
+            return false;
+        }
+        recordUndo();
+
+        markDirty(lineIndex);
+        targetNode->edit().replace(charIndex, text.length(), text);
+        journalEdit(JournalOp::Replace, lineIndex, charIndex, 0, text);
+        return true;
+    }
+
+    // Applies a batch of edits as one undo step, walking the document once. The edits may come in
+    // any order; edits of one line must not overlap, inserts at the same position keep their order
+    // and come before a delete or replace there.
+    // Returns false and changes nothing when an edit is outside of the text or overlaps another.
+    bool applyEdits(const vector<TextEdit>& edits) {
+        commitCursorLine();
+        if (edits.empty()) {
+            return true;
+        }
+        size_t lastLine = 0;
+        for (const TextEdit& edit : edits) {
+            lastLine = max(lastLine, edit.line);
+        }
+        document.materializeUpTo(lastLine);
+        if (lastLine >= document.size()) {
+            return false;
+        }
+
+        // Counting sort by line, then a sort by position among the edits of each line
+        vector<size_t> lineStarts(lastLine + 2, 0);
+        for (const TextEdit& edit : edits) {
+            lineStarts[edit.line + 1]++;
+        }
+        for (size_t line = 1; line < lineStarts.size(); line++) {
+            lineStarts[line] += lineStarts[line - 1];
+        }
+        vector<size_t> order(edits.size());
+        vector<size_t> next(lineStarts.begin(), lineStarts.end() - 1);
+        for (size_t i = 0; i < edits.size(); i++) {
+            order[next[edits[i].line]++] = i;
+        }
+
+        // Check every edit before the first change
+        struct LineEdits {
+            TextNode* node;
+            size_t line;
+        };
+        vector<LineEdits> lines;
+        TextNode* node = document.first();
+        for (size_t line = 0; line <= lastLine; line++, node = node->next.get()) {
+            auto begin = order.begin() + lineStarts[line];
+            auto end = order.begin() + lineStarts[line + 1];
+            if (begin == end) {
+                continue;
+            }
+            // Inserts go before a delete or replace at the same position, so the input order cannot
+            // decide whether a batch is accepted; stable, so inserts there keep the order they were given in
+            stable_sort(begin, end, [&](size_t a, size_t b) {
+                if (edits[a].position != edits[b].position) {
+                    return edits[a].position < edits[b].position;
+                }
+                return edits[a].kind == TextEdit::Kind::Insert && edits[b].kind != TextEdit::Kind::Insert;
+            });
+            const size_t length = node->text().size();
+            size_t previousEnd = 0;
+            for (auto i = begin; i != end; ++i) {
+                const TextEdit& edit = edits[*i];
+                bool isInside = edit.kind == TextEdit::Kind::Insert ? edit.position <= length : edit.position < length;
+                if (!isInside || edit.position < previousEnd) {
+                    return false;
+                }
+                previousEnd = edit.position + edit.span(length);
+            }
+            lines.push_back({node, line});
+        }
+
+        recordUndo();
+        string text;
+        for (const LineEdits& line : lines) {
+            string_view original = line.node->text();
+            text.clear();
+            size_t copied = 0;
+            for (size_t i = lineStarts[line.line]; i < lineStarts[line.line + 1]; i++) {
+                const TextEdit& edit = edits[order[i]];
+                text.append(original, copied, edit.position - copied);
+                if (edit.kind != TextEdit::Kind::Delete) {
+                    text += edit.text;
+                }
+                copied = edit.position + edit.span(original.size());
+            }
+            text.append(original, copied);
+            line.node->setText(text);
+            markDirty(line.line);
+        }
+        journalEdit(JournalOp::ApplyEdits, 0, 0, edits.size(), TextEdit::pack(edits));
+        return true;
+    }
+
+    // Turns on the write-ahead journal at path. With recover, the edits that an earlier session
+    // left there are replayed first and the journal goes on after them. They are replayed without
+    // recording history, so the recovered document starts with empty undo and redo.
+    // Returns the number of edits replayed; throws when the journal cannot be written or another
+    // editor holds it.
+    size_t startJournal(const string& path, bool recover) {
+        journal.reset();
+        // Replaying the journal of an editor that is still running would mix its edits into this document
+        if (EditJournal::isInUse(path)) {
+            throw runtime_error("Journal is used by another editor: " + path);
+        }
+        journalPath = path;
+        size_t replayed = 0;
+        uint64_t validBytes = 0;
+        if (recover) {
+            isHistoryPaused = true;
+            try {
+                for (const JournalRecord& record : EditJournal::read(path, validBytes)) {
+                    replayJournalRecord(record);
+                    replayed++;
+                }
+                commitCursorLine();
+            } catch (...) {
+                isHistoryPaused = false;
+                throw;
+            }
+            isHistoryPaused = false;
+            undoStack.clear();
+            redoStack.clear();
+            breakUndoGroup();
+        }
+        try {
+            if (recover && validBytes > 0) {
+                journal = make_unique<EditJournal>(path, validBytes);
+            } else {
+                journal = make_unique<EditJournal>(path);
+                journal->restart(JournalRecord{}); // a new, empty document
+            }
+        } catch (const runtime_error&) {
+            journal.reset();
+            throw;
+        }
+        return replayed;
+    }
+
+    // True when a journal holds edits that were never saved
+    static bool hasJournaledEdits(const string& path) {
+        uint64_t validBytes;
+        for (const JournalRecord& record : EditJournal::read(path, validBytes)) {
+            if (record.op != JournalOp::Base) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // On a clean exit: finishes a running autosave and removes the files the session kept on disk,
+    // the journal with its base files and the undo steps spilled to disk
+    void closeSession() {
+        autosaver.reset();
+        undoStack.clear();
+        redoStack.clear();
+        if (!journal) {
+            return;
+        }
+        journal.reset();
+        for (const string& file : {journalPath, journalPath + ".base0", journalPath + ".base1"}) {
+            error_code error;
+            filesystem::remove(file, error);
+        }
+    }
+
+    bool isJournaling() const {
+        return journal != nullptr;
+    }
+
+    const string& journalFile() const {
+        return journalPath;
+    }
+
+    EditJournal::Stats journalStats() const {
+        return journal ? journal->statistics() : EditJournal::Stats{};
+    }
+};
+
+#endif // TEXTLIST_H
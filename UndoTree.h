@@ -0,0 +1,238 @@
+#ifndef UNDOTREE_H
+#define UNDOTREE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
+#include "TextDocument.h"
+
+using namespace std;
+
+// Every state of the document as a version in a tree: undo goes to the parent, redo to the child
+// that was visited last, and editing after an undo starts a new branch instead of dropping the old one.
+// A version stores its lines in immutable chunks; chunks without edited lines are shared with
+// the parent, so a version costs the chunks it changed plus one pointer per chunk.
+// Going to a version builds the whole document from its chunks, so it costs O(document).
+// prune keeps the tree within a version limit and a byte budget; version ids stay the same.
+class UndoTree {
+public:
+    static const size_t noVersion = SIZE_MAX;
+
+private:
+    static const size_t chunkLines = 256;
+
+    struct Chunk {
+        string bytes;
+        vector<uint32_t> ends; // line i ends at ends[i] and starts where line i - 1 ends
+    };
+
+    struct Version {
+        size_t parent = noVersion;
+        size_t lastChild = noVersion;
+        size_t childCount = 0;
+        size_t lineCount = 0;
+        bool isPruned = false;
+        vector<shared_ptr<const Chunk>> chunks;
+    };
+
+    vector<Version> versions;
+    size_t liveVersions = 0;
+    size_t firstLive = 0; // versions before it were all pruned
+    size_t chunkCount = 0;
+    uint64_t storedBytes = 0;
+
+    static uint64_t chunkBytes(const Chunk& chunk) {
+        return chunk.bytes.size() + chunk.ends.size() * sizeof(uint32_t);
+    }
+
+    // A version can go when nothing hangs off it: a branch tip, or the root of a single line of versions
+    bool isPrunable(size_t id, size_t current, bool keepsParent) const {
+        const Version& version = versions[id];
+        return !version.isPruned && id != current && !(keepsParent && id == versions[current].parent) &&
+               (version.childCount == 0 || (version.parent == noVersion && version.childCount == 1));
+    }
+
+    void remove(size_t id) {
+        Version& version = versions[id];
+        for (auto& chunk : version.chunks) {
+            if (chunk.use_count() == 1) {
+                chunkCount--;
+                storedBytes -= chunkBytes(*chunk);
+            }
+        }
+        version.chunks.clear();
+        version.chunks.shrink_to_fit();
+        version.isPruned = true;
+        liveVersions--;
+
+        if (version.childCount == 1) {
+            versions[version.lastChild].parent = noVersion;
+        }
+        size_t parent = version.parent;
+        if (parent != noVersion) {
+            Version& parentVersion = versions[parent];
+            parentVersion.childCount--;
+            if (parentVersion.lastChild == id) {
+                // Redo goes on to the newest child that is left
+                parentVersion.lastChild = noVersion;
+                for (size_t child = versions.size() - 1; child > parent && parentVersion.childCount > 0; child--) {
+                    if (!versions[child].isPruned && versions[child].parent == parent) {
+                        parentVersion.lastChild = child;
+                        break;
+                    }
+                }
+            }
+        }
+        while (firstLive < versions.size() && versions[firstLive].isPruned) {
+            firstLive++;
+        }
+    }
+
+    shared_ptr<const Chunk> buildChunk(TextNode*& node) {
+        auto chunk = make_shared<Chunk>();
+        for (size_t i = 0; i < chunkLines && node; i++) {
+            chunk->bytes.append(node->text());
+            chunk->ends.push_back(static_cast<uint32_t>(chunk->bytes.size()));
+            node = node->next.get();
+        }
+        chunkCount++;
+        storedBytes += chunkBytes(*chunk);
+        return chunk;
+    }
+
+public:
+    // Adds the document as a child of parent. Only the chunks that hold one of the dirty lines
+    // are built again; without a parent every chunk is built.
+    size_t add(TextDocument& document, size_t parent, const vector<pair<size_t, size_t>>& dirtyLines) {
+        document.materializeAll();
+        Version version;
+        version.parent = parent;
+        version.lineCount = document.size();
+        const size_t chunkTotal = (version.lineCount + chunkLines - 1) / chunkLines;
+        const Version* base = parent == noVersion ? nullptr : &versions[parent];
+
+        vector<bool> isDirty(chunkTotal, base == nullptr);
+        if (base) {
+            for (auto [begin, end] : dirtyLines) {
+                end = min(end, version.lineCount);
+                for (size_t chunk = begin / chunkLines; begin < end && chunk <= (end - 1) / chunkLines; chunk++) {
+                    isDirty[chunk] = true;
+                }
+            }
+            // Lines were added or removed: the chunks from the first one that differs in size on are new
+            if (version.lineCount != base->lineCount) {
+                size_t firstChanged = min(version.lineCount, base->lineCount) / chunkLines;
+                fill(isDirty.begin() + min(firstChanged, chunkTotal), isDirty.end(), true);
+            }
+        }
+
+        version.chunks.reserve(chunkTotal);
+        TextNode* node = document.first();
+        size_t nodeIndex = 0;
+        for (size_t chunk = 0; chunk < chunkTotal; chunk++) {
+            if (!isDirty[chunk]) {
+                version.chunks.push_back(base->chunks[chunk]);
+                continue;
+            }
+            for (; nodeIndex < chunk * chunkLines; nodeIndex++) {
+                node = node->next.get();
+            }
+            version.chunks.push_back(buildChunk(node));
+            nodeIndex += version.chunks.back()->ends.size();
+        }
+
+        versions.push_back(move(version));
+        liveVersions++;
+        size_t id = versions.size() - 1;
+        if (parent != noVersion) {
+            versions[parent].lastChild = id;
+            versions[parent].childCount++;
+        }
+        return id;
+    }
+
+    TextDocument restore(size_t id) const {
+        TextDocument document;
+        bool isFirst = true;
+        for (const auto& chunk : versions[id].chunks) {
+            uint32_t start = 0;
+            for (uint32_t end : chunk->ends) {
+                string_view line(chunk->bytes.data() + start, end - start);
+                if (isFirst) {
+                    document.setFirst(line);
+                    isFirst = false;
+                } else {
+                    document.append(line);
+                }
+                start = end;
+            }
+        }
+        return document;
+    }
+
+    // Drops the oldest versions that nothing depends on until at most maxVersions are left and the
+    // chunks fit into maxBytes (0 means no budget). The current version is always kept, and so is its
+    // parent when only the budget is exceeded, so the last change can be undone like with the stacks.
+    void prune(size_t current, size_t maxVersions, uint64_t maxBytes) {
+        size_t id = firstLive;
+        while (id < versions.size() && (liveVersions > maxVersions || (maxBytes && storedBytes > maxBytes))) {
+            if (isPrunable(id, current, liveVersions <= maxVersions)) {
+                remove(id);
+                // The parent of a pruned branch tip may have become prunable in turn
+                id = firstLive;
+            } else {
+                id++;
+            }
+        }
+    }
+
+    // Marks the way to a version, so redo from its parent leads back to it
+    void visit(size_t id) {
+        size_t parent = versions[id].parent;
+        if (parent != noVersion) {
+            versions[parent].lastChild = id;
+        }
+    }
+
+    bool contains(size_t id) const {
+        return id < versions.size() && !versions[id].isPruned;
+    }
+
+    size_t parent(size_t id) const {
+        return versions[id].parent;
+    }
+
+    size_t lastChild(size_t id) const {
+        return versions[id].lastChild;
+    }
+
+    size_t childCount(size_t id) const {
+        return versions[id].childCount;
+    }
+
+    size_t lineCount(size_t id) const {
+        return versions[id].lineCount;
+    }
+
+    // Version ids are below size; pruned ones are not contained any more
+    size_t size() const {
+        return versions.size();
+    }
+
+    size_t versionCount() const {
+        return liveVersions;
+    }
+
+    size_t chunksStored() const {
+        return chunkCount;
+    }
+
+    uint64_t bytesStored() const {
+        return storedBytes;
+    }
+};
+
+#endif // UNDOTREE_H
@@ -0,0 +1,273 @@
+// Drives the engine through the C API: batches of edits, edits at several cursors, saving only
+// the changed lines and recovering from the journal. Prints every failed check and returns 1.
+
+#include "EditorApi.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(condition)                                                  \
+    do {                                                                  \
+        if (!(condition)) {                                               \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            failures++;                                                   \
+        }                                                                 \
+    } while (0)
+
+static char* copyText(Editor* editor) {
+    size_t length = 0;
+    editorGetText(editor, NULL, 0, &length);
+    char* text = malloc(length + 1);
+    if (editorGetText(editor, text, length + 1, &length) != EDITOR_OK) {
+        text[0] = '\0';
+    }
+    return text;
+}
+
+static int hasText(Editor* editor, const char* expected) {
+    char* text = copyText(editor);
+    int isEqual = strcmp(text, expected) == 0;
+    if (!isEqual) {
+        fprintf(stderr, "text is \"%s\", expected \"%s\"\n", text, expected);
+    }
+    free(text);
+    return isEqual;
+}
+
+static char* readFile(const char* path) {
+    FILE* file = fopen(path, "rb");
+    if (!file) {
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char* data = malloc(size + 1);
+    data[fread(data, 1, size, file)] = '\0';
+    fclose(file);
+    return data;
+}
+
+// A saved file has no '\n' after its last line, editorGetText has one after every line
+static int isSavedAs(Editor* editor, const char* path) {
+    char* text = copyText(editor);
+    char* saved = readFile(path);
+    size_t length = saved ? strlen(saved) : 0;
+    int isEqual = saved && strncmp(text, saved, length) == 0 && strcmp(text + length, "\n") == 0;
+    free(text);
+    free(saved);
+    return isEqual;
+}
+
+static int hasCursor(Editor* editor, size_t index, size_t line, size_t position) {
+    size_t cursorLine, cursorPosition;
+    return editorGetCursor(editor, index, &cursorLine, &cursorPosition) == EDITOR_OK && cursorLine == line &&
+           cursorPosition == position;
+}
+
+static void testApplyEdits(void) {
+    Editor* editor = editorCreate();
+    editorAppend(editor, "abcdef");
+    editorAppend(editor, "ghi");
+
+    // Any order; inserts at the same position keep theirs, an insert may touch the end of a replace
+    EditorEdit edits[] = {
+        {EDITOR_EDIT_INSERT, 0, 2, 0, "B"},
+        {EDITOR_EDIT_DELETE, 1, 0, 1, NULL},
+        {EDITOR_EDIT_INSERT, 0, 2, 0, "A"},
+        {EDITOR_EDIT_REPLACE, 0, 0, 0, "xy"},
+        {EDITOR_EDIT_INSERT, 0, 4, 0, "Q"},
+        {EDITOR_EDIT_DELETE, 0, 4, 1, NULL},
+    };
+    CHECK(editorApplyEdits(editor, edits, 6) == EDITOR_OK);
+    CHECK(hasText(editor, "xyBAcdQf\nhi\n"));
+
+    // Overlapping ranges, a position past the end and a line past the end change nothing
+    EditorEdit overlapping[] = {
+        {EDITOR_EDIT_DELETE, 0, 1, 3, NULL},
+        {EDITOR_EDIT_REPLACE, 0, 3, 0, "zz"},
+    };
+    CHECK(editorApplyEdits(editor, overlapping, 2) == EDITOR_OUT_OF_RANGE);
+    EditorEdit insertInsideDelete[] = {
+        {EDITOR_EDIT_DELETE, 0, 1, 3, NULL},
+        {EDITOR_EDIT_INSERT, 0, 2, 0, "q"},
+    };
+    CHECK(editorApplyEdits(editor, insertInsideDelete, 2) == EDITOR_OUT_OF_RANGE);
+    EditorEdit outside[] = {
+        {EDITOR_EDIT_INSERT, 0, 0, 0, "ok"},
+        {EDITOR_EDIT_INSERT, 1, 3, 0, "late"},
+    };
+    CHECK(editorApplyEdits(editor, outside, 2) == EDITOR_OUT_OF_RANGE);
+    EditorEdit noLine = {EDITOR_EDIT_DELETE, 2, 0, 1, NULL};
+    CHECK(editorApplyEdits(editor, &noLine, 1) == EDITOR_OUT_OF_RANGE);
+    EditorEdit lineBreak = {EDITOR_EDIT_INSERT, 0, 0, 0, "a\nb"};
+    CHECK(editorApplyEdits(editor, &lineBreak, 1) == EDITOR_INVALID_ARGUMENT);
+    CHECK(hasText(editor, "xyBAcdQf\nhi\n"));
+
+    // The whole batch is one undo step
+    CHECK(editorUndo(editor) == EDITOR_OK);
+    CHECK(hasText(editor, "abcdef\nghi\n"));
+
+    // An insert at the start of a delete is accepted whichever of them is given first
+    EditorEdit deleteFirst[] = {
+        {EDITOR_EDIT_DELETE, 0, 2, 3, NULL},
+        {EDITOR_EDIT_INSERT, 0, 2, 0, "Z"},
+    };
+    CHECK(editorApplyEdits(editor, deleteFirst, 2) == EDITOR_OK);
+    CHECK(hasText(editor, "abZf\nghi\n"));
+    CHECK(editorUndo(editor) == EDITOR_OK);
+    EditorEdit insertFirst[] = {
+        {EDITOR_EDIT_INSERT, 0, 2, 0, "Z"},
+        {EDITOR_EDIT_DELETE, 0, 2, 3, NULL},
+    };
+    CHECK(editorApplyEdits(editor, insertFirst, 2) == EDITOR_OK);
+    CHECK(hasText(editor, "abZf\nghi\n"));
+    editorDestroy(editor);
+}
+
+static void testCursors(void) {
+    Editor* editor = editorCreate();
+    editorAppend(editor, "abc");
+    editorAppend(editor, "abc");
+
+    // Added out of order; a cursor added twice counts once
+    CHECK(editorAddCursor(editor, 1, 0) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 0, 3) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 0, 1) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 0, 1) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 0, 4) == EDITOR_OUT_OF_RANGE);
+    size_t count = 0;
+    CHECK(editorCursorCount(editor, &count) == EDITOR_OK && count == 3);
+
+    // Every cursor moves by what was typed before it on its line
+    CHECK(editorTypeAtCursors(editor, "XY") == EDITOR_OK);
+    CHECK(hasText(editor, "aXYbcXY\nXYabc\n"));
+    CHECK(hasCursor(editor, 0, 0, 3) && hasCursor(editor, 1, 0, 7) && hasCursor(editor, 2, 1, 2));
+
+    CHECK(editorEraseBeforeCursors(editor, 1) == EDITOR_OK);
+    CHECK(hasText(editor, "aXbcX\nXabc\n"));
+    CHECK(hasCursor(editor, 0, 0, 2) && hasCursor(editor, 1, 0, 5) && hasCursor(editor, 2, 1, 1));
+
+    // Ranges running into each other are erased once, the cursors at their start become one
+    CHECK(editorEraseBeforeCursors(editor, 3) == EDITOR_OK);
+    CHECK(hasText(editor, "\nabc\n"));
+    CHECK(editorCursorCount(editor, &count) == EDITOR_OK && count == 2);
+    CHECK(hasCursor(editor, 0, 0, 0) && hasCursor(editor, 1, 1, 0));
+
+    CHECK(editorEraseAfterCursors(editor, 2) == EDITOR_OK);
+    CHECK(hasText(editor, "\nc\n"));
+
+    // Undo restores the text and drops the cursors, which would point into the old text
+    CHECK(editorUndo(editor) == EDITOR_OK);
+    CHECK(hasText(editor, "\nabc\n"));
+    CHECK(editorCursorCount(editor, &count) == EDITOR_OK && count == 0);
+    CHECK(editorTypeAtCursors(editor, "z") == EDITOR_OK);
+    CHECK(hasText(editor, "\nabc\n"));
+    editorDestroy(editor);
+}
+
+static void testSaveChanges(void) {
+    const char* path = "editor-api-test-save.txt";
+    Editor* editor = editorCreate();
+    for (int line = 0; line < 1000; line++) {
+        char text[32];
+        snprintf(text, sizeof(text), "line %d", line);
+        editorAppend(editor, text);
+    }
+    CHECK(editorSave(editor, path) == EDITOR_OK);
+    CHECK(editorLoad(editor, path, 0) == EDITOR_OK);
+
+    // A line that keeps its length is written in place
+    size_t bytesWritten = 0;
+    int isFullRewrite = 1;
+    CHECK(editorReplace(editor, 500, 0, "LINE") == EDITOR_OK);
+    CHECK(editorSaveChanges(editor, path, &bytesWritten, &isFullRewrite) == EDITOR_OK);
+    CHECK(!isFullRewrite && bytesWritten < 100);
+    CHECK(isSavedAs(editor, path));
+
+    // A line near the end that grows rewrites the file from there on
+    CHECK(editorInsert(editor, 998, 4, " longer") == EDITOR_OK);
+    CHECK(editorSaveChanges(editor, path, &bytesWritten, &isFullRewrite) == EDITOR_OK);
+    CHECK(!isFullRewrite && bytesWritten < 100);
+    CHECK(isSavedAs(editor, path));
+
+    // Lines added after the last save change the length from there on, too
+    CHECK(editorAppend(editor, "appended") == EDITOR_OK);
+    CHECK(editorSaveChanges(editor, path, &bytesWritten, &isFullRewrite) == EDITOR_OK);
+    CHECK(isSavedAs(editor, path));
+
+    editorDestroy(editor);
+    remove(path);
+}
+
+static void testJournalRecovery(void) {
+    const char* path = "editor-api-test-journal.txt";
+    const char* journal = "editor-api-test.journal";
+    Editor* editor = editorCreate();
+    editorAppend(editor, "first line");
+    editorAppend(editor, "second line");
+    CHECK(editorSave(editor, path) == EDITOR_OK);
+    editorDestroy(editor);
+
+    editor = editorCreate();
+    CHECK(editorStartJournal(editor, journal, 0, NULL) == EDITOR_OK);
+    CHECK(editorLoad(editor, path, 0) == EDITOR_OK);
+    CHECK(editorInsert(editor, 0, 5, " new") == EDITOR_OK);
+    CHECK(editorNewLine(editor) == EDITOR_OK);
+    CHECK(editorAppend(editor, "third line") == EDITOR_OK);
+    CHECK(editorCut(editor, 1, 0, 7) == EDITOR_OK);
+    CHECK(editorPaste(editor, 2, 0) == EDITOR_OK);
+    CHECK(editorUndo(editor) == EDITOR_OK);
+    CHECK(editorRedo(editor) == EDITOR_OK);
+    EditorEdit edits[] = {
+        {EDITOR_EDIT_REPLACE, 0, 0, 0, "F"},
+        {EDITOR_EDIT_DELETE, 1, 0, 1, NULL},
+    };
+    CHECK(editorApplyEdits(editor, edits, 2) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 0, 0) == EDITOR_OK);
+    CHECK(editorAddCursor(editor, 2, 0) == EDITOR_OK);
+    CHECK(editorTypeAtCursors(editor, "> ") == EDITOR_OK);
+    char* expected = copyText(editor);
+    // Gone without closing the session, as after a crash: the journal stays behind
+    editorDestroy(editor);
+
+    editor = editorCreate();
+    size_t replayed = 0;
+    CHECK(editorStartJournal(editor, journal, 1, &replayed) == EDITOR_OK);
+    CHECK(replayed > 1);
+    CHECK(hasText(editor, expected));
+    // The recovered document goes on journaling after the replayed edits
+    CHECK(editorAppend(editor, "after recovery") == EDITOR_OK);
+    free(expected);
+    expected = copyText(editor);
+    editorDestroy(editor);
+
+    editor = editorCreate();
+    CHECK(editorStartJournal(editor, journal, 1, NULL) == EDITOR_OK);
+    CHECK(hasText(editor, expected));
+    CHECK(editorCloseSession(editor) == EDITOR_OK);
+    FILE* left = fopen(journal, "rb");
+    CHECK(left == NULL);
+    if (left) {
+        fclose(left);
+    }
+    free(expected);
+    editorDestroy(editor);
+    remove(path);
+}
+
+int main(void) {
+    testApplyEdits();
+    testCursors();
+    testSaveChanges();
+    testJournalRecovery();
+    if (failures > 0) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("All checks passed\n");
+    return 0;
+}